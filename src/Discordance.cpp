@@ -0,0 +1,331 @@
+#include "Discordance.h"
+#include <algorithm>
+#include <unordered_set>
+
+/**
+ * @brief Constructor of the Discordance class, distances are -1 until calculated
+ */
+Discordance::Discordance(){
+    rfDistance = -1;
+    normRFDistance = -1.0;
+    deepCoalescences = -1;
+    tripletDistance = -1;
+    normTripletDistance = -1.0;
+    numTips = 0;
+}
+
+/**
+ * @brief Fills a vector with the nodes below r in postorder (left subtree, right subtree, node)
+ * @details Nodes are collected root first with right children ahead of left ones and then reversed,
+ *          so no recursion is needed for very unbalanced trees
+ *
+ * @param r root of the subtree
+ * @param order vector filled with the nodes
+ */
+void Discordance::postOrder(Node *r, std::vector<Node*> &order){
+    order.clear();
+    if(r == nullptr)
+        return;
+    std::vector<Node*> nodeStack;
+    nodeStack.push_back(r);
+    while(!nodeStack.empty()){
+        Node *p = nodeStack.back();
+        nodeStack.pop_back();
+        order.push_back(p);
+        if(p->getRdes() != nullptr){
+            nodeStack.push_back(p->getLdes());
+            nodeStack.push_back(p->getRdes());
+        }
+    }
+    std::reverse(order.begin(), order.end());
+}
+
+/**
+ * @brief Finds the last common ancestor of two nodes of the restricted species tree
+ *
+ * @param a first node
+ * @param b second node
+ * @param parent ancestor of each node, -1 for the root
+ * @param depth number of edges between each node and the root
+ * @return int index of the last common ancestor
+ */
+int Discordance::findLCA(int a, int b, const std::vector<int> &parent, const std::vector<int> &depth){
+    while(depth[a] > depth[b])
+        a = parent[a];
+    while(depth[b] > depth[a])
+        b = parent[b];
+    while(a != b){
+        a = parent[a];
+        b = parent[b];
+    }
+    return a;
+}
+
+/**
+ * @brief Counts the rooted triplets resolved the same way in two trees on the same leaves
+ * @details A triplet ab|c is shared if the pair ab has last common ancestors v in the gene tree and w in the species
+ *          tree with c outside both clades. For every pair of internal nodes v and w the pairs with these last common
+ *          ancestors are counted from the overlaps of their children, |v1 & w1||v2 & w2| + |v1 & w2||v2 & w1|, and each
+ *          pair is completed by the n - |v| - |w| + |v & w| leaves outside both clades. The overlaps of a species node
+ *          with all gene nodes are kept as one column built from the columns of its children. Species nodes are
+ *          visited with the larger child first, so at most log2(n) columns are kept at a time.
+ *
+ * @param gLeft left child of each gene node, -1 for leaves, children are numbered before their parents
+ * @param gRight right child of each gene node
+ * @param gLo first leaf position of each gene clade, leaves are numbered in gene tree postorder
+ * @param gHi last leaf position of each gene clade
+ * @param spLeft left child of each species node, -1 for leaves
+ * @param spRight right child of each species node
+ * @param spMin first leaf number of each species clade
+ * @param spMax last leaf number of each species clade
+ * @param repPos position in the gene tree of the gene copy of each species leaf number
+ * @return long long number of shared triplets
+ */
+long long Discordance::countSharedTriplets(const std::vector<int> &gLeft, const std::vector<int> &gRight,
+                                           const std::vector<int> &gLo, const std::vector<int> &gHi,
+                                           const std::vector<int> &spLeft, const std::vector<int> &spRight,
+                                           const std::vector<int> &spMin, const std::vector<int> &spMax,
+                                           const std::vector<int> &repPos){
+    int nG = (int) gLeft.size();
+    int nSp = (int) spLeft.size();
+    int n = spMax[nSp - 1] - spMin[nSp - 1] + 1;
+
+    // species nodes in postorder with the larger child first: reverse of a preorder that visits the smaller child first
+    std::vector<int> order, nodeStack;
+    nodeStack.push_back(nSp - 1);
+    while(!nodeStack.empty()){
+        int w = nodeStack.back();
+        nodeStack.pop_back();
+        order.push_back(w);
+        if(spLeft[w] >= 0){
+            int a = spLeft[w], b = spRight[w];
+            if(spMax[a] - spMin[a] < spMax[b] - spMin[b])
+                std::swap(a, b);
+            nodeStack.push_back(a);
+            nodeStack.push_back(b);
+        }
+    }
+    std::reverse(order.begin(), order.end());
+
+    std::vector<std::vector<int> > cols(nSp);
+    auto overlap = [&](int v, int w) -> int {
+        if(spLeft[w] >= 0)
+            return cols[w][v];
+        int pos = repPos[spMin[w]];
+        return (gLo[v] <= pos && pos <= gHi[v]) ? 1 : 0;
+    };
+
+    long long shared = 0;
+    for(auto w : order){
+        if(spLeft[w] < 0)
+            continue;
+        int w1 = spLeft[w], w2 = spRight[w];
+        int wSize = spMax[w] - spMin[w] + 1;
+        std::vector<int> &col = cols[w];
+        col.resize(nG);
+        for(int v = 0; v < nG; v++)
+            col[v] = overlap(v, w1) + overlap(v, w2);
+        for(int v = 0; v < nG; v++){
+            if(gLeft[v] < 0)
+                continue;
+            int v1 = gLeft[v], v2 = gRight[v];
+            long long pairs = (long long) overlap(v1, w1) * overlap(v2, w2) + (long long) overlap(v1, w2) * overlap(v2, w1);
+            if(pairs > 0)
+                shared += pairs * (n - (gHi[v] - gLo[v] + 1) - wSize + col[v]);
+        }
+        std::vector<int>().swap(cols[w1]);
+        std::vector<int>().swap(cols[w2]);
+    }
+    return shared;
+}
+
+/**
+ * @brief Calculates the Robinson-Foulds distance, the triplet distance and the number of deep coalescences of an extant gene tree
+ * @details The species tree is restricted to the species with an extant gene copy and its nodes are renumbered in
+ *          postorder, so every ancestor has a larger number than its descendants. Each species clade is then the
+ *          interval of leaf numbers below it. For the Robinson-Foulds and triplet distances each species keeps only
+ *          its first gene copy in postorder. When the copies of a species form a clade of the gene tree this is the
+ *          same as collapsing that clade to a single tip. A gene tree clade is shared with the species tree if the
+ *          leaf numbers of its tips form one of the species intervals. The triplet distance is the number of triplets
+ *          of species resolved differently by the two trees. Deep coalescences use all gene copies and are the sum
+ *          over species tree edges of the number of gene lineages crossing the edge minus one.
+ *
+ * @param st species tree the gene tree was simulated in
+ * @param gt gene tree
+ */
+void Discordance::calcDiscordance(SpeciesTree *st, GeneTree *gt){
+    rfDistance = -1;
+    normRFDistance = -1.0;
+    deepCoalescences = -1;
+    tripletDistance = -1;
+    normTripletDistance = -1.0;
+    numTips = 0;
+
+    std::vector<Node*> order;
+    std::vector<Node*> spNodes = st->getNodes();
+
+    // species with at least one extant gene copy
+    std::vector<unsigned> copies(spNodes.size(), 0);
+    postOrder(gt->getRoot(), order);
+    for(auto p : order){
+        if(p->getRdes() == nullptr && p->getIsExtant()){
+            if(p->getIndex() < 0 || p->getIndex() >= (int) copies.size())
+                return;
+            copies[p->getIndex()]++;
+            numTips++;
+        }
+    }
+    if(numTips < 2)
+        return;
+
+    // restrict the species tree, stack holds the restricted node of each subtree (-1 if it has no gene copies)
+    std::vector<int> spParent, spDepth, spMin, spMax, spLeft, spRight;
+    std::vector<int> spLeafId(spNodes.size(), -1);
+    std::vector<int> valStack;
+    int nLeaves = 0;
+    int l, r, id;
+    postOrder(st->getRoot(), order);
+    for(auto p : order){
+        if(p->getRdes() == nullptr){
+            id = -1;
+            if(p->getIndex() >= 0 && p->getIndex() < (int) copies.size() && copies[p->getIndex()] > 0){
+                id = (int) spParent.size();
+                spParent.push_back(-1);
+                spLeft.push_back(-1);
+                spRight.push_back(-1);
+                spMin.push_back(nLeaves);
+                spMax.push_back(nLeaves);
+                spLeafId[p->getIndex()] = id;
+                nLeaves++;
+            }
+            valStack.push_back(id);
+        }
+        else{
+            r = valStack.back();
+            valStack.pop_back();
+            l = valStack.back();
+            valStack.pop_back();
+            if(l >= 0 && r >= 0){
+                id = (int) spParent.size();
+                spParent.push_back(-1);
+                spLeft.push_back(l);
+                spRight.push_back(r);
+                spMin.push_back(spMin[l]);
+                spMax.push_back(spMax[r]);
+                spParent[l] = id;
+                spParent[r] = id;
+                valStack.push_back(id);
+            }
+            else
+                valStack.push_back(l >= 0 ? l : r);
+        }
+    }
+    int nSp = (int) spParent.size();
+    spDepth.assign(nSp, 0);
+    for(int i = nSp - 1; i >= 0; i--){
+        if(spParent[i] >= 0)
+            spDepth[i] = spDepth[spParent[i]] + 1;
+    }
+
+    std::unordered_set<long long> spClusters;
+    unsigned numSpClusters = 0;
+    for(int i = 0; i < nSp; i++){
+        int size = spMax[i] - spMin[i] + 1;
+        if(size > 1 && size < nLeaves){
+            spClusters.insert((long long) spMin[i] * nLeaves + spMax[i]);
+            numSpClusters++;
+        }
+    }
+
+    // walk the gene tree: map each node to the species tree and build the gene tree pruned to one copy per species
+    struct GeneClade { int map, rep; };
+    std::vector<GeneClade> geneStack;
+    std::vector<int> linesIn(nSp, 0), linesOut(nSp, 0);
+    std::vector<int> gLeft, gRight, gLo, gHi, gMin, gMax;
+    std::vector<int> repPos(nLeaves, -1);
+    int numReps = 0;
+    postOrder(gt->getRoot(), order);
+    for(auto p : order){
+        if(p->getRdes() == nullptr){
+            GeneClade gc = {-1, -1};
+            if(p->getIsExtant()){
+                gc.map = spLeafId[p->getIndex()];
+                int k = spMin[gc.map];
+                if(repPos[k] < 0){
+                    repPos[k] = numReps;
+                    gc.rep = (int) gLeft.size();
+                    gLeft.push_back(-1);
+                    gRight.push_back(-1);
+                    gLo.push_back(numReps);
+                    gHi.push_back(numReps);
+                    gMin.push_back(k);
+                    gMax.push_back(k);
+                    numReps++;
+                }
+            }
+            geneStack.push_back(gc);
+        }
+        else{
+            GeneClade rc = geneStack.back();
+            geneStack.pop_back();
+            GeneClade lc = geneStack.back();
+            geneStack.pop_back();
+            GeneClade gc;
+            if(lc.map >= 0 && rc.map >= 0){
+                gc.map = findLCA(lc.map, rc.map, spParent, spDepth);
+                linesIn[lc.map]++;
+                linesIn[rc.map]++;
+                linesOut[gc.map] += 2;
+            }
+            else
+                gc.map = lc.map >= 0 ? lc.map : rc.map;
+            if(lc.rep >= 0 && rc.rep >= 0){
+                gc.rep = (int) gLeft.size();
+                gLeft.push_back(lc.rep);
+                gRight.push_back(rc.rep);
+                gLo.push_back(gLo[lc.rep]);
+                gHi.push_back(gHi[rc.rep]);
+                gMin.push_back(std::min(gMin[lc.rep], gMin[rc.rep]));
+                gMax.push_back(std::max(gMax[lc.rep], gMax[rc.rep]));
+            }
+            else
+                gc.rep = lc.rep >= 0 ? lc.rep : rc.rep;
+            geneStack.push_back(gc);
+        }
+    }
+    // the lineage above the gene tree root runs all the way to the species tree root
+    linesIn[geneStack.back().map]++;
+
+    // lineages entering the edge above s minus lineages that coalesce within the clade below s
+    deepCoalescences = 0;
+    for(int i = 0; i < nSp; i++){
+        if(spParent[i] < 0)
+            continue;
+        linesIn[spParent[i]] += linesIn[i];
+        linesOut[spParent[i]] += linesOut[i];
+        if(linesIn[i] - linesOut[i] > 1)
+            deepCoalescences += linesIn[i] - linesOut[i] - 1;
+    }
+
+    unsigned numGeneClusters = 0, numShared = 0;
+    for(unsigned v = 0; v < gLeft.size(); v++){
+        int count = gHi[v] - gLo[v] + 1;
+        if(count > 1 && count < nLeaves){
+            numGeneClusters++;
+            if(gMax[v] - gMin[v] + 1 == count && spClusters.count((long long) gMin[v] * nLeaves + gMax[v]))
+                numShared++;
+        }
+    }
+    rfDistance = (int) (numSpClusters - numShared) + (int) (numGeneClusters - numShared);
+    normRFDistance = (nLeaves > 2) ? rfDistance / (2.0 * (nLeaves - 2)) : 0.0;
+
+    long long numTriplets = (long long) nLeaves * (nLeaves - 1) * (nLeaves - 2) / 6;
+    if(numTriplets > 0){
+        tripletDistance = numTriplets - countSharedTriplets(gLeft, gRight, gLo, gHi, spLeft, spRight, spMin, spMax, repPos);
+        normTripletDistance = (double) tripletDistance / numTriplets;
+    }
+    else{
+        tripletDistance = 0;
+        normTripletDistance = 0.0;
+    }
+}
@@ -0,0 +1,44 @@
+#ifndef Discordance_h
+#define Discordance_h
+
+#include "SpeciesTree.h"
+#include "GeneTree.h"
+#include <vector>
+
+/**
+ * @brief Discordance between an extant gene tree and the species tree it was simulated in
+ * @details Both trees are restricted to the species that have extant gene copies. Robinson-Foulds and triplet
+ *          distances compare the species tree with the gene tree pruned to one gene copy per species. Robinson-Foulds
+ *          distances use Day's encoding of species tree clades as intervals of a postorder leaf numbering, so each
+ *          gene tree clade is checked in constant time. Deep coalescences are counted from the LCA mapping of all
+ *          gene copies onto the species tree.
+ */
+class Discordance{
+    private:
+        int         rfDistance;
+        double      normRFDistance;
+        int         deepCoalescences;
+        long long   tripletDistance;
+        double      normTripletDistance;
+        unsigned    numTips;
+
+        static void postOrder(Node *r, std::vector<Node*> &order);
+        static int  findLCA(int a, int b, const std::vector<int> &parent, const std::vector<int> &depth);
+        static long long countSharedTriplets(const std::vector<int> &gLeft, const std::vector<int> &gRight,
+                                             const std::vector<int> &gLo, const std::vector<int> &gHi,
+                                             const std::vector<int> &spLeft, const std::vector<int> &spRight,
+                                             const std::vector<int> &spMin, const std::vector<int> &spMax,
+                                             const std::vector<int> &repPos);
+
+    public:
+                    Discordance();
+        void        calcDiscordance(SpeciesTree *st, GeneTree *gt);
+        int         getRFDistance() { return rfDistance; }
+        double      getNormRFDistance() { return normRFDistance; }
+        int         getDeepCoalescences() { return deepCoalescences; }
+        long long   getTripletDistance() { return tripletDistance; }
+        double      getNormTripletDistance() { return normTripletDistance; }
+        unsigned    getNumTips() { return numTips; }
+};
+
+#endif /* Discordance_h */
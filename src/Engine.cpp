@@ -1,6 +1,12 @@
 #include <utility>
 
 #include "Engine.h"
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <thread>
 /**
  * @brief Constructor for the engine class
  * @param of string giving the outfile prefix
@@ -36,6 +42,17 @@ Engine::Engine(std::string of, int mt, double sbr, double sdr, double gbr, doubl
     doScaleTree = false;
     treescale = ts;
     printOutputToScreen = sout;
+    statsToCalc = 0;
+    numThreads = 1;
+    sampleReconstructed = false;
+    dtwfSwitch = 0;
+    profiling = false;
+    tracing = false;
+    progress = nullptr;
+    maxNodes = 0;
+    maxMemory = 0.0;
+    checkpointInterval = 0;
+    resumeRun = false;
     individidualsPerPop = ipp;
     populationSize = popsize;
     generationTime = genTime;
@@ -54,6 +71,31 @@ Engine::Engine(std::string of, int mt, double sbr, double sdr, double gbr, doubl
     std::cout << "\nSeeds = {" << gs1 << ", " << gs2 << "}" << std::endl;
 }
 
+/**
+ * @brief Copy constructor of the engine class, copies the settings only
+ * @details The copy starts without simulated trees, progress report, summary, or profile of its own, so the
+ *          parameter rows of a sweep can each change a copy of the settings without sharing the trees of the
+ *          original. Assignment is deleted.
+ *
+ * @param e Engine to copy the settings of
+ */
+Engine::Engine(const Engine &e) : outfilename(e.outfilename), inputSpTree(e.inputSpTree),
+                                  inputSpTreeFile(e.inputSpTreeFile), sweepFile(e.sweepFile), simType(e.simType),
+                                  numTaxa(e.numTaxa), numSpeciesTrees(e.numSpeciesTrees), numLoci(e.numLoci),
+                                  numGenes(e.numGenes), treescale(e.treescale), doScaleTree(e.doScaleTree),
+                                  outgroupFrac(e.outgroupFrac), rando(e.rando), spBirthRate(e.spBirthRate),
+                                  spDeathRate(e.spDeathRate), proportionToSample(e.proportionToSample),
+                                  geneBirthRate(e.geneBirthRate), geneDeathRate(e.geneDeathRate),
+                                  transferRate(e.transferRate), individidualsPerPop(e.individidualsPerPop),
+                                  populationSize(e.populationSize), generationTime(e.generationTime),
+                                  printOutputToScreen(e.printOutputToScreen), sampleReconstructed(e.sampleReconstructed),
+                                  dtwfSwitch(e.dtwfSwitch), statsToCalc(e.statsToCalc), profiling(e.profiling),
+                                  tracing(e.tracing), progress(nullptr), maxNodes(e.maxNodes), maxMemory(e.maxMemory),
+                                  birthRateChanges(e.birthRateChanges), deathRateChanges(e.deathRateChanges),
+                                  checkpointInterval(e.checkpointInterval), resumeRun(e.resumeRun),
+                                  numThreads(e.numThreads) {
+}
+
 /**
  * @brief Destructor of engine class
  *
@@ -68,99 +110,468 @@ Engine::~Engine(){
 
 /**
  * @brief Function that creates a Simulator class and runs the simulation saving information in the TreeInfo class.
+ * @details The files of each replicate are written as soon as it is simulated. With a checkpoint interval set, the
+ *          state of the run is saved to <prefix>.checkpoint every that many replicates, and a resumed run starts
+ *          from the last checkpoint with the random number generator, summary, and profile it had then, so it
+ *          writes the same files as a run that was never stopped.
  *
+ * @return false if the run was to be resumed and the checkpoint could not be read
  */
-void Engine::doRunRun(){
+bool Engine::doRunRun(){
     // double TS = 0.0;
     TreeInfo *ti = nullptr;
-    for(int k = 0; k < numSpeciesTrees; k++){
-
-        auto *treesim = new Simulator(&rando,
-                                           numTaxa,
-                                           spBirthRate,
-                                           spDeathRate,
-                                           1.0,
-                                           numLoci,
-                                           geneBirthRate,
-                                           geneDeathRate,
-                                           transferRate,
-                                           individidualsPerPop,
-                                           populationSize,
-                                           generationTime,
-                                           numGenes,
-                                           outgroupFrac,
-                                           treescale,
-                                           printOutputToScreen);
-        if(printOutputToScreen)
-            std::cout << "Simulating species tree replicate # " << k + 1 << std::endl;
-
-        switch(simType){
-            case 1:
-                treesim->simSpeciesTree();
-                break;
-            case 2:
-                treesim->simSpeciesLociTrees();
-                break;
-            case 3:
-                treesim->simThreeTree();
-                break;
-            case 4:
-                treesim->simLocusGeneTrees();
-                break;
-            case 5:
-                treesim->simMoranSpeciesTree();
-                break;
-            default:
-                treesim->simSpeciesTree();
-                break;
+    int firstRep = 0;
+    if(resumeRun){
+        if(!this->readCheckpoint(firstRep))
+            return false;
+        std::cout << "Resuming the run at species tree replicate # " << firstRep + 1 << std::endl;
+    }
+    RunTrace trace(tracing ? 1 : 0);
+    SimProgress prog((unsigned long) numSpeciesTrees, (unsigned long) firstRep);
+    if(printOutputToScreen){
+        progress = &prog;
+        prog.start();
+    }
+    // one Simulator runs every replicate so its trees and nodes are reused
+    Simulator *treesim = this->newSimulator(&rando, printOutputToScreen);
+    for(int k = firstRep; k < numSpeciesTrees; k++){
+        treesim->setTrace(trace.getBuffer(0), k);
+        ti = this->simulateReplicate(k, treesim);
+        this->addToRunSummary(ti, runSummary);
+        this->writeTreeInfoFiles(ti, k, trace.getBuffer(0));
+        this->addToRunProfile(ti, runProfile);
+        delete ti;
+        prog.addReplicate();
+        if(checkpointInterval > 0 && (k + 1) % checkpointInterval == 0 && k + 1 < numSpeciesTrees)
+            this->writeCheckpoint(k + 1);
+    }
+    delete treesim;
+    prog.finish();
+    progress = nullptr;
+    this->writeRunSummary((unsigned) numSpeciesTrees);
+    this->writeRunProfile();
+    this->writeRunTrace(trace);
+    if(checkpointInterval > 0 || resumeRun)
+        std::remove((outfilename + ".checkpoint").c_str());
+    return true;
+}
+
+/**
+ * @brief Creates a Simulator with the settings of the Engine
+ *
+ * @param rng random number generator to use
+ * @param sout true if the simulation progress should be printed to the screen
+ * @return Simulator* owned by the caller
+ */
+Simulator* Engine::newSimulator(MbRandom *rng, bool sout){
+    auto *treesim = new Simulator(rng,
+                                       numTaxa,
+                                       spBirthRate,
+                                       spDeathRate,
+                                       proportionToSample,
+                                       numLoci,
+                                       geneBirthRate,
+                                       geneDeathRate,
+                                       transferRate,
+                                       individidualsPerPop,
+                                       populationSize,
+                                       generationTime,
+                                       numGenes,
+                                       outgroupFrac,
+                                       treescale,
+                                       sout);
+    treesim->setSampleReconstructed(sampleReconstructed);
+    treesim->setDTWFSwitch(dtwfSwitch);
+    treesim->setProgress(progress);
+    treesim->setNodeBudget(maxNodes, maxMemory);
+    treesim->setRateFunctions(RateFunction::create(spBirthRate, birthRateChanges),
+                              RateFunction::create(spDeathRate, deathRateChanges));
+    return treesim;
+}
+
+/**
+ * @brief Simulates one replicate with a Simulator that may be reused across replicates
+ * @details The trees left in the Simulator by its last replicate are cleared first, keeping their memory for this one.
+ *          A replicate whose trees go over the node budget is stopped and returned marked as aborted, without trees.
+ *
+ * @param k index of the replicate
+ * @param treesim Simulator created by newSimulator
+ * @return TreeInfo* with the trees and statistics of the replicate
+ */
+TreeInfo* Engine::simulateReplicate(int k, Simulator *treesim){
+    TraceSpan span(treesim->getTrace(), "replicate", k);
+    auto *ti = new TreeInfo(k, numLoci);
+    SimProfile *prof = profiling ? &ti->getProfile() : nullptr;
+    treesim->reset();
+    treesim->setProfile(prof);
+
+    switch(simType){
+        case 1:
+            treesim->simSpeciesTree();
+            break;
+        case 2:
+            treesim->simSpeciesLociTrees();
+            break;
+        case 3:
+            treesim->simThreeTree();
+            break;
+        case 4:
+            treesim->simLocusGeneTrees();
+            break;
+        case 5:
+            treesim->simMoranSpeciesTree();
+            break;
+        default:
+            treesim->simSpeciesTree();
+            break;
+    }
+    treesim->setProfile(nullptr);
+    ti->setPeakNodes(treesim->getPeakNodes());
+    if(treesim->isOverBudget()){
+        // the unfinished trees are left in the Simulator to be recycled by the next replicate
+        ti->setAborted(treesim->getMaxNodes());
+        return ti;
+    }
+
+    SimProfile::Timer timer(prof, SimProfile::Phase_Printing);
+    if(statsToCalc)
+        ti->setSpeciesTreeStatistics(treesim->calcSpeciesTreeStatistics());
+    ti->setWholeTreeStringInfo(treesim->printSpeciesTreeNewick());
+    ti->setExtTreeStringInfo(treesim->printExtSpeciesTreeNewick());
+    ti->setExtSpeciesTreeDepth(treesim->calcExtantSpeciesTreeDepth());
+    ti->setNumberTransfers(treesim->findNumberTransfers());
+    ti->setNumberDuplications(treesim->findNumberDuplications());
+    ti->setNumberLosses(treesim->findNumberLosses());
+    ti->setGSARestarts(treesim->getGSARestarts());
+    ti->setGSAWastedEvents(treesim->getGSAWastedEvents());
+    this->setTreeLengthStats(ti, treesim);
+
+    for(int i = 0; i < numLoci; i++){
+        ti->setLocusTreeByIndx(k, treesim->printLocusTreeNewick(i));
+        if(simType == 3){
+            for(int j = 0; j < numGenes; j++){
+                ti->setGeneTreeByIndx(i, j, treesim->printGeneTreeNewick(i, j));
+                if(statsToCalc)
+                    ti->setGeneTreeStatisticsByIndx(i, j, treesim->calcGeneTreeStatistics(i, j));
+                if(statsToCalc & TreeStatistics::Stat_Discordance)
+                    ti->setGeneTreeDiscordanceByIndx(i, j, treesim->calcGeneTreeDiscordance(i, j));
+                ti->setExtantGeneTreeByIndx(i, j, treesim->printExtantGeneTreeNewick(i, j));
+            }
+        }
+    }
+    return ti;
+}
+
+/**
+ * @brief Runs every row of a parameter sweep table in one process
+ * @details Each row of the table is a copy of the settings of this Engine with the columns of the row changed.
+ *          All (row, replicate) jobs are shared by a pool of threads; the seeds of each job are drawn from the Engine's
+ *          random number generator in the order of the jobs, so the trees do not depend on the number of threads.
+ *          The files of row r are written with the prefix <prefix>_row<r>, the summary of a row is written once all of
+ *          its replicates are done. The quantiles of a row summary are approximate and can change slightly with the
+ *          order in which replicates finish.
+ *
+ * @return false if the table could not be read or has invalid settings
+ */
+bool Engine::doRunSweep(){
+    std::vector<std::string> columns;
+    std::vector<std::vector<double> > rows;
+    if(!this->readSweepTable(sweepFile, columns, rows))
+        return false;
+
+    std::vector<std::pair<unsigned, int> > jobs;
+    std::vector<int> repsLeft(rows.size());
+    for(unsigned r = 0; r < rows.size(); r++){
+        Engine rowEngine(*this);
+        for(unsigned c = 0; c < columns.size(); c++)
+            rowEngine.setParameter(columns[c], rows[r][c]);
+        rowEngine.setSimTypeFromParameters();
+        if(rowEngine.spBirthRate <= 0.0 || rowEngine.numTaxa < 2 || rowEngine.numSpeciesTrees < 0 ||
+           rowEngine.proportionToSample <= 0.0 || rowEngine.proportionToSample > 1.0){
+            std::cerr << "Row " << r << " of " << sweepFile << " needs a positive species birth rate, ";
+            std::cerr << "at least 2 taxa, no negative number of replicates, and a sampling fraction in (0, 1]" << std::endl;
+            return false;
         }
+        for(int k = 0; k < rowEngine.numSpeciesTrees; k++)
+            jobs.emplace_back(r, k);
+        repsLeft[r] = rowEngine.numSpeciesTrees;
+    }
+    std::cout << "Running " << rows.size() << " parameter rows of " << sweepFile << " (" << jobs.size() << " replicates)" << std::endl;
+
+    unsigned nThreads = (numThreads > 1) ? numThreads : 1;
+    std::vector<RunSummary> rowSummaries(rows.size());
+    std::vector<RunProfile> rowProfiles(rows.size());
+    RunTrace trace(tracing ? nThreads : 0);
+    std::mutex jobMutex;
+    size_t nextJob = 0;
+    SimProgress prog(jobs.size());
+    if(printOutputToScreen){
+        progress = &prog;
+        prog.start();
+    }
 
-        ti =  new TreeInfo(k, numLoci);
-        
-        ti->setWholeTreeStringInfo(treesim->printSpeciesTreeNewick());
-        ti->setExtTreeStringInfo(treesim->printExtSpeciesTreeNewick());
-        ti->setSpeciesTreeDepth(treesim->calcSpeciesTreeDepth());
-        ti->setExtSpeciesTreeDepth(treesim->calcExtantSpeciesTreeDepth());
-        ti->setNumberTransfers(treesim->findNumberTransfers());
-        ti->setNumberDuplications(treesim->findNumberDuplications());
-        ti->setNumberLosses(treesim->findNumberLosses());
-        ti->setNumberGenerations(treesim->findAveNumberGenerations());
-
-        for(int i = 0; i < numLoci; i++){
-            ti->setLocusTreeByIndx(k, treesim->printLocusTreeNewick(i));
-            if(simType == 3){
-                for(int j = 0; j < numGenes; j++){
-                    ti->setGeneTreeByIndx(i, j, treesim->printGeneTreeNewick(i, j));
-                    ti->setExtantGeneTreeByIndx(i, j, treesim->printExtantGeneTreeNewick(i, j));
+    auto runJobs = [&](unsigned t){
+        seedType sd1, sd2;
+        size_t j;
+        // jobs are handed out row by row, so each worker keeps the Engine and Simulator of its current row and
+        // reuses them for every replicate of the row it runs, reseeding the generator for each one
+        std::unique_ptr<Engine> rowEngine;
+        std::unique_ptr<Simulator> treesim;
+        unsigned rowOfEngine = 0;
+        MbRandom jobRando;
+        while(true){
+            {
+                std::lock_guard<std::mutex> lock(jobMutex);
+                if(nextJob >= jobs.size())
+                    return;
+                j = nextJob++;
+                this->drawReplicateSeeds(sd1, sd2);
+                if(!rowEngine || rowOfEngine != jobs[j].first){
+                    treesim.reset();
+                    rowEngine.reset(new Engine(*this));
                 }
             }
+            unsigned r = jobs[j].first;
+            if(!treesim){
+                for(unsigned c = 0; c < columns.size(); c++)
+                    rowEngine->setParameter(columns[c], rows[r][c]);
+                rowEngine->setSimTypeFromParameters();
+                rowEngine->outfilename = outfilename + "_row" + std::to_string(r);
+                rowEngine->printOutputToScreen = false;
+                treesim.reset(rowEngine->newSimulator(&jobRando, printOutputToScreen && nThreads == 1));
+                rowOfEngine = r;
+            }
+
+            jobRando.setSeed(sd1, sd2);
+            if(trace.getBuffer(t) != nullptr)
+                trace.getBuffer(t)->setRow((int) r);
+            treesim->setTrace(trace.getBuffer(t), jobs[j].second);
+            TreeInfo *ti = rowEngine->simulateReplicate(jobs[j].second, treesim.get());
+            rowEngine->writeTreeInfoFiles(ti, jobs[j].second, trace.getBuffer(t));
+            {
+                std::lock_guard<std::mutex> lock(jobMutex);
+                rowEngine->addToRunSummary(ti, rowSummaries[r]);
+                rowEngine->addToRunProfile(ti, rowProfiles[r]);
+                if(--repsLeft[r] == 0){
+                    rowEngine->runSummary = std::move(rowSummaries[r]);
+                    rowEngine->writeRunSummary((unsigned) rowEngine->numSpeciesTrees);
+                    rowEngine->runProfile = std::move(rowProfiles[r]);
+                    rowEngine->writeRunProfile();
+                }
+            }
+            delete ti;
+            prog.addReplicate();
         }
-        simSpeciesTrees.push_back(ti);
-        delete treesim;
+    };
+
+    if(nThreads == 1)
+        runJobs(0);
+    else{
+        std::vector<std::thread> workers;
+        for(unsigned t = 0; t < nThreads; t++)
+            workers.emplace_back(runJobs, t);
+        for(auto & w : workers)
+            w.join();
     }
+    prog.finish();
+    progress = nullptr;
+    this->writeRunTrace(trace);
+    return true;
+}
 
-    this->writeTreeFiles();
+/**
+ * @brief Reads a parameter sweep table
+ * @details The first line names the columns with the flags of the settings they change (with or without the dash),
+ *          every following line is one row of values. Columns are separated by whitespace, empty lines and lines
+ *          starting with # are skipped.
+ *
+ * @param fn name of the table file
+ * @param columns filled with the names of the columns
+ * @param rows filled with the values of each row
+ * @return false if the file could not be read, a column is not a sweep setting, or a row is malformed
+ */
+bool Engine::readSweepTable(const std::string &fn, std::vector<std::string> &columns, std::vector<std::vector<double> > &rows){
+    std::ifstream in(fn);
+    if(!in.is_open()){
+        std::cerr << "Unable to open sweep table " << fn << std::endl;
+        return false;
+    }
+    std::string line, field;
+    int lineNum = 0;
+    while(getline(in, line)){
+        lineNum++;
+        std::stringstream ss(line);
+        if(!(ss >> field) || field[0] == '#')
+            continue;
+        if(columns.empty()){
+            do{
+                if(field[0] == '-')
+                    field.erase(0, 1);
+                bool known = false;
+                for(auto & param : sweepParameters())
+                    known = known || param.first == field;
+                if(!known){
+                    std::cerr << "Unknown column " << field << " in sweep table " << fn << ", columns can be ";
+                    for(unsigned i = 0; i < sweepParameters().size(); i++)
+                        std::cerr << (i > 0 ? ", " : "") << sweepParameters()[i].first;
+                    std::cerr << std::endl;
+                    return false;
+                }
+                columns.push_back(field);
+            } while(ss >> field);
+            continue;
+        }
+        std::vector<double> row;
+        do{
+            char *numEnd;
+            double x = strtod(field.c_str(), &numEnd);
+            if(*numEnd != '\0'){
+                std::cerr << "Invalid value " << field << " on line " << lineNum << " of sweep table " << fn << std::endl;
+                return false;
+            }
+            row.push_back(x);
+        } while(ss >> field);
+        if(row.size() != columns.size()){
+            std::cerr << "Line " << lineNum << " of sweep table " << fn << " has " << row.size() << " values for ";
+            std::cerr << columns.size() << " columns" << std::endl;
+            return false;
+        }
+        rows.push_back(row);
+    }
+    if(rows.empty()){
+        std::cerr << "Sweep table " << fn << " has no rows" << std::endl;
+        return false;
+    }
+    return true;
 }
 
 /**
- * @brief Writes two species tree files (one with all tips, one with only extant tips. Writes locus trees, writes gene trees. Also, writes a tree file. This function loops through the treeInfo class with information saved for each simulation and writes that information out.
+ * @brief The settings that can be changed by name in a parameter sweep, with the flag of each
  *
+ * @return vector of flag names without the dash and the function that sets each
+ */
+const std::vector<std::pair<std::string, Engine::ParameterSetter> > &Engine::sweepParameters(){
+    static const std::vector<std::pair<std::string, ParameterSetter> > params = {
+        {"sbr", [](Engine &e, double x){ e.spBirthRate = x; }},
+        {"sdr", [](Engine &e, double x){ e.spDeathRate = x; }},
+        {"gbr", [](Engine &e, double x){ e.geneBirthRate = x; }},
+        {"gdr", [](Engine &e, double x){ e.geneDeathRate = x; }},
+        {"lgtr", [](Engine &e, double x){ e.transferRate = x; }},
+        {"ipp", [](Engine &e, double x){ e.individidualsPerPop = (int) x; }},
+        {"ne", [](Engine &e, double x){ e.populationSize = (int) x; }},
+        {"nt", [](Engine &e, double x){ e.numTaxa = (int) x; }},
+        {"r", [](Engine &e, double x){ e.numSpeciesTrees = (int) x; }},
+        {"nl", [](Engine &e, double x){ e.numLoci = (int) x; }},
+        {"ng", [](Engine &e, double x){ e.numGenes = (int) x; }},
+        {"og", [](Engine &e, double x){ e.outgroupFrac = x; }},
+        {"sc", [](Engine &e, double x){ e.treescale = x; }},
+        {"dtwf", [](Engine &e, double x){ e.dtwfSwitch = (unsigned) x; }},
+        {"rho", [](Engine &e, double x){ e.proportionToSample = x; }}
+    };
+    return params;
+}
+
+/**
+ * @brief Changes one setting of the Engine by the name of its command line flag
  *
+ * @param flag name of the flag without the dash
+ * @param x new value of the setting
+ * @return false if the flag is not a setting that can be swept
  */
-void Engine::writeTreeFiles(){
+bool Engine::setParameter(const std::string &flag, double x){
+    for(auto & param : sweepParameters()){
+        if(param.first == flag){
+            param.second(*this, x);
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Picks which trees to simulate from the settings the same way as the command line does, without printing
+ */
+void Engine::setSimTypeFromParameters(){
+    if(numLoci <= 0)
+        simType = (simType == 5) ? 5 : 1;
+    else if(geneBirthRate < 0.0)
+        simType = 1;
+    else if(populationSize > 0 && individidualsPerPop > 0 && (individidualsPerPop <= populationSize || dtwfSwitch > 0))
+        simType = 3;
+    else
+        simType = 2;
+}
+
+/**
+ * @brief Fills in the tree length, treeness, tip length, and depth statistics of a TreeInfo from a finished simulation
+ * @details Each species and locus tree is visited once for all of its statistics, and the depth of each gene tree is
+ *          walked once for both the gene tree TMRCA and the generations
+ *
+ * @param ti TreeInfo of the current replicate
+ * @param treesim Simulator holding the simulated trees
+ */
+void Engine::setTreeLengthStats(TreeInfo *ti, Simulator *treesim){
+    double trLen, trNess, aveTipLen, trDepth;
+    treesim->calcSpeciesTreeLengthStats(trLen, trNess, aveTipLen, trDepth);
+    ti->setSpeciesTreeLength(trLen);
+    ti->setSpeciesTreeNess(trNess);
+    ti->setSpeciesAveTipLen(aveTipLen);
+    ti->setSpeciesTreeDepth(trDepth);
+    treesim->calcLocusTreeLengthStats(trLen, trNess, aveTipLen);
+    ti->setLocusTreeLength(trLen);
+    ti->setLocusTreeNess(trNess);
+    ti->setLocusAveTipLen(aveTipLen);
+    double aveTMRCA;
+    std::vector<double> aveGenerations;
+    if(treesim->calcGeneTreeDepthStats(aveTMRCA, aveGenerations)){
+        ti->setAveTMRCAGeneTree(aveTMRCA);
+        ti->setNumberGenerations(aveGenerations);
+    }
+}
+
+/**
+ * @brief Writes two species tree files (one with all tips, one with only extant tips. Writes locus trees, writes gene trees. Also, writes a tree file. This function loops through the treeInfo class with information saved for each simulation and writes that information out.
+ *
+ * @param tb trace buffer of the calling thread, nullptr if the run is not traced
+ */
+void Engine::writeTreeFiles(TraceBuffer *tb){
 
     for(auto p = simSpeciesTrees.begin(); p != simSpeciesTrees.end(); p++){
         int d = (int) std::distance(simSpeciesTrees.begin(), p);
-        (*p)->writeTreeStatsFile(d, outfilename);
-        (*p)->writeWholeTreeFileInfo(d, outfilename);
-        (*p)->writeExtantTreeFileInfo(d, outfilename);
-        for(auto i = 0; i < numLoci; i++){
-            (*p)->writeLocusTreeFileInfoByIndx(d, i, outfilename);
-            if(simType == 3)
-                // for(int j = 0; j < numGenes; j++){
-                //     (*p)->writeGeneTreeFileInfoByIndx(d, i, j, outfilename);
-                // }
-                (*p)->writeExtGeneTreeFileInfo(d, i, numGenes, outfilename);
+        this->writeTreeInfoFiles(*p, d, tb);
+        this->addToRunProfile(*p, runProfile);
+    }
+}
+
+/**
+ * @brief Writes the species, locus, and gene tree files and the stats file of one replicate
+ *
+ * @param ti TreeInfo of the replicate
+ * @param d index of the replicate used in the file names
+ * @param tb trace buffer of the calling thread, nullptr if the run is not traced
+ */
+void Engine::writeTreeInfoFiles(TreeInfo *ti, int d, TraceBuffer *tb){
+    TraceSpan span(tb, "writeTreeInfoFiles", d);
+    SimProfile::Timer timer(profiling ? &ti->getProfile() : nullptr, SimProfile::Phase_FileWrite);
+    if(ti->getAborted()){
+        ti->writeAbortedFile(d, outfilename);
+        std::stringstream msg;
+        msg << "Replicate " << d << " aborted, its trees needed more than the budget of " << ti->getMaxNodes() << " nodes\n";
+        std::cerr << msg.str();
+        return;
+    }
+    ti->writeTreeStatsFile(d, outfilename, statsToCalc);
+    ti->writeWholeTreeFileInfo(d, outfilename);
+    ti->writeExtantTreeFileInfo(d, outfilename);
+    for(auto i = 0; i < numLoci; i++){
+        ti->writeLocusTreeFileInfoByIndx(d, i, outfilename);
+        if(simType == 3){
+            // for(int j = 0; j < numGenes; j++){
+            //     ti->writeGeneTreeFileInfoByIndx(d, i, j, outfilename);
+            // }
+            ti->writeExtGeneTreeFileInfo(d, i, numGenes, outfilename);
+            if(statsToCalc & TreeStatistics::Stat_Discordance)
+                ti->writeGeneTreeDiscordanceFile(d, i, outfilename);
         }
     }
 }
@@ -187,302 +598,415 @@ TreeInfo* Engine::findTreeByIndx(int i){
 }
 
 /**
- * @brief calculates the averages root age of all the saved species trees in the simulation run. This is saved to an outfile
- * @todo connect this with the stats file output
+ * @brief Adds the statistics of one replicate to the summary of the run
+ * @details Only the running summaries are updated so the summary does not depend on keeping the replicates in memory
+ *
+ * @param ti TreeInfo of the finished replicate
+ * @param summary RunSummary to add the statistics to
  */
-void Engine::calcAverageRootAgeSpeciesTrees(){
-    std::ofstream out;
-    out.open("Average_root_depths_spTree.out");
-    double sumRH = 0.0;
-    for(auto & simSpeciesTree : simSpeciesTrees){
-        sumRH += simSpeciesTree->getSpeciesTreeDepth();
-        out << simSpeciesTree->getSpeciesTreeDepth() << "\n";
+void Engine::addToRunSummary(TreeInfo *ti, RunSummary &summary){
+    if(ti->getAborted())
+        return;
+    summary.addValue("Tree depth", ti->getSpeciesTreeDepth());
+    summary.addValue("Extant tree depth", ti->getExtSpeciesTreeDepth());
+    summary.addValue("Tree length", ti->getSpeciesTreeLength());
+    summary.addValue("Treeness", ti->getSpeciesTreeNess());
+    summary.addValue("Average tip length", ti->getSpeciesAveTipLen());
+    if(simType < 4 && !sampleReconstructed){
+        summary.addValue("GSA restarts", ti->getGSARestarts());
+        summary.addValue("GSA wasted events", ti->getGSAWastedEvents());
     }
-    out.close();
-
-    std::cout << "\n #### Average Root Age of Species Trees is " << (double) sumRH / numSpeciesTrees << " #####" << std::endl;
+    if(numLoci > 0 && simType > 1 && simType < 5){
+        summary.addValue("Transfers", ti->getNumberTransfers());
+        summary.addValue("Duplications", ti->getNumberDuplications());
+        summary.addValue("Losses", ti->getNumberLosses());
+        summary.addValue("Locus tree length", ti->getLocusTreeLength());
+        summary.addValue("Locus treeness", ti->getLocusTreeNess());
+        summary.addValue("Locus tip length", ti->getLocusAveTipLen());
+    }
+    if((simType == 3 || simType == 4) && !ti->getNumberGenerations().empty()){
+        summary.addValue("Gene tree TMRCA", ti->getAveTMRCAGeneTree());
+        for(auto ng : ti->getNumberGenerations())
+            summary.addValue("Gene tree generations", ng);
+    }
+    summary.addValue("Peak nodes", ti->getPeakNodes());
+
+    TreeStatistics &ss = ti->getSpeciesTreeStatistics();
+    if(statsToCalc & TreeStatistics::Stat_Colless)
+        summary.addValue("Colless", ss.getColless());
+    if(statsToCalc & TreeStatistics::Stat_Sackin)
+        summary.addValue("Sackin", ss.getSackin());
+    if(statsToCalc & TreeStatistics::Stat_Gamma)
+        summary.addValue("Gamma", ss.getGamma());
+    if(statsToCalc & TreeStatistics::Stat_Cherries)
+        summary.addValue("Cherries", ss.getNumCherries());
+    for(auto & locusStats : ti->getGeneTreeStatistics()){
+        for(auto & gs : locusStats){
+            if(statsToCalc & TreeStatistics::Stat_Colless)
+                summary.addValue("Gene tree Colless", gs.getColless());
+            if(statsToCalc & TreeStatistics::Stat_Sackin)
+                summary.addValue("Gene tree Sackin", gs.getSackin());
+            if(statsToCalc & TreeStatistics::Stat_Gamma)
+                summary.addValue("Gene tree Gamma", gs.getGamma());
+            if(statsToCalc & TreeStatistics::Stat_Cherries)
+                summary.addValue("Gene tree Cherries", gs.getNumCherries());
+        }
+    }
+    for(auto & locusDiscord : ti->getGeneTreeDiscordance()){
+        for(auto & gd : locusDiscord){
+            if(gd.getRFDistance() >= 0){
+                summary.addValue("Gene tree RF", gd.getRFDistance());
+                summary.addValue("Gene tree normalized RF", gd.getNormRFDistance());
+            }
+            if(gd.getTripletDistance() >= 0){
+                summary.addValue("Gene tree triplet distance", (double) gd.getTripletDistance());
+                summary.addValue("Gene tree normalized triplet distance", gd.getNormTripletDistance());
+            }
+            if(gd.getDeepCoalescences() >= 0)
+                summary.addValue("Deep coalescences", gd.getDeepCoalescences());
+        }
+    }
+}
 
+/**
+ * @brief Writes the summary of all replicates of the run to <prefix>.summary.txt and to the screen
+ *
+ * @param numReps number of replicates in the summary
+ */
+void Engine::writeRunSummary(unsigned numReps){
+    if(runSummary.empty())
+        return;
+    std::ofstream out(outfilename + ".summary.txt");
+    runSummary.printSummary(out);
+    if(printOutputToScreen){
+        std::cout << "\n#### Summary of " << numReps << " replicates ####" << std::endl;
+        runSummary.printSummary(std::cout);
+    }
+}
 
+/**
+ * @brief Adds the profile of a replicate to a RunProfile once its files are written
+ *
+ * @param ti TreeInfo of the finished replicate
+ * @param rp RunProfile to add the profile to
+ */
+void Engine::addToRunProfile(TreeInfo *ti, RunProfile &rp){
+    if(profiling)
+        rp.addReplicate(ti->getProfile());
 }
 
 /**
- * @brief counts the number of leaves in a Newick string. This is heaveily modified by those used in a tutorial by Paul Lewis (https://phylogeny.uconn.edu/phylogenetic-software-development-tutorial/build-a-tree-from-a-newick-description/)
- * @param spTreeStr Newick tree string input by user
- * @return unsigned int Number of leaves
+ * @brief Writes the profile of the run and of each of its replicates to <prefix>.profile.json
  */
-unsigned int Engine::countNewickLeaves(const std::string& spTreeStr){
-    std::regex taxonregexpr (R"((\w*\.?[\w|\s|\.]?\w*)\:)");
-    std::sregex_iterator it1(spTreeStr.begin(), spTreeStr.end(), taxonregexpr);
-    std::sregex_iterator it2;
-    return (unsigned) std::distance(it1, it2);
+void Engine::writeRunProfile(){
+    if(!profiling || runProfile.empty())
+        return;
+    std::ofstream out(outfilename + ".profile.json");
+    runProfile.writeJson(out);
 }
 
 /**
- * @brief Strips comments from input newick string
+ * @brief Writes the spans recorded by the workers of the run to <prefix>.trace.json
  *
- * @param spTreeStr Species tree string input with comments
- * @return std::string Same species tree string stripped of comments
+ * @param trace spans of the run, empty if the run was not traced
  */
-std::string Engine::stripCommentsFromNewickTree(const std::string& spTreeStr){
-    std::string commentlessNewick;
-    std::regex commentregexpr ("\\[.*?\\]");
-    commentlessNewick = std::regex_replace(spTreeStr,commentregexpr,std::string(""));
-    return commentlessNewick;
+void Engine::writeRunTrace(const RunTrace &trace){
+    if(tracing)
+        trace.writeJson(outfilename + ".trace.json");
 }
 
 /**
- * @brief formats the names of tips given in input Newick string files to remove spaces and other tricky characters
- * @param spTreeStr input newick tree
+ * @brief Settings that must not change between a run and its resumption, as one line of text
+ */
+std::string Engine::getCheckpointSettings(){
+    std::stringstream ss;
+    ss << std::setprecision(17) << simType << " " << numTaxa << " " << numSpeciesTrees << " " << numLoci << " ";
+    ss << numGenes << " " << treescale << " " << outgroupFrac << " " << spBirthRate << " " << spDeathRate << " ";
+    ss << geneBirthRate << " " << geneDeathRate << " " << transferRate << " " << individidualsPerPop << " ";
+    ss << populationSize << " " << generationTime << " " << sampleReconstructed << " " << dtwfSwitch << " " << statsToCalc << " ";
+    ss << maxNodes << " " << maxMemory << " " << birthRateChanges.toString() << " " << deathRateChanges.toString() << " ";
+    ss << proportionToSample << " " << profiling;
+    return ss.str();
+}
+
+/**
+ * @brief Saves the state of a run to <prefix>.checkpoint once all replicates before nextRep are written
+ * @details The file is written under a temporary name and renamed, so a run stopped while writing it keeps the
+ *          previous checkpoint
  *
- * @return std::string string with characters removed
+ * @param nextRep index of the first replicate not yet simulated
+ * @return false if the checkpoint could not be written
  */
-std::string Engine::formatTipNamesFromNewickTree(const std::string& spTreeStr){
-    std::string formattedNewick;
-    std::regex taxonregexpr (R"((\w*\.?[\w|\s|\.]?\w*)\:)");
+bool Engine::writeCheckpoint(int nextRep){
+    std::string fn = outfilename + ".checkpoint";
+    {
+        std::ofstream out(fn + ".tmp");
+        if(!out.is_open()){
+            std::cerr << "Unable to write the checkpoint " << fn << std::endl;
+            return false;
+        }
+        out << "treeducken checkpoint 2\n" << getCheckpointSettings() << "\n" << nextRep << "\n";
+        rando.writeState(out);
+        runSummary.writeState(out);
+        runProfile.writeState(out);
+        if(!out.good()){
+            std::cerr << "Unable to write the checkpoint " << fn << std::endl;
+            return false;
+        }
+    }
+    return std::rename((fn + ".tmp").c_str(), fn.c_str()) == 0;
+}
 
-    formattedNewick = std::regex_replace(spTreeStr,taxonregexpr, "'$1':");
-    return formattedNewick;
+/**
+ * @brief Restores the random number generator, summary, and profile of a run from <prefix>.checkpoint
+ *
+ * @param nextRep set to the index of the first replicate not yet simulated
+ * @return false if there is no checkpoint, it can not be read, or it was written with different settings
+ */
+bool Engine::readCheckpoint(int &nextRep){
+    std::string fn = outfilename + ".checkpoint";
+    std::ifstream in(fn);
+    if(!in.is_open()){
+        std::cerr << "There is no checkpoint " << fn << " to resume from." << std::endl;
+        return false;
+    }
+    std::string header, settings;
+    getline(in, header);
+    getline(in, settings);
+    if(header != "treeducken checkpoint 2"){
+        std::cerr << fn << " is not a treeducken checkpoint." << std::endl;
+        return false;
+    }
+    if(settings != getCheckpointSettings()){
+        std::cerr << "The checkpoint " << fn << " was written with different settings, ";
+        std::cerr << "resume with the settings of the original run." << std::endl;
+        return false;
+    }
+    if(!(in >> nextRep) || nextRep < 0 || nextRep > numSpeciesTrees || !rando.readState(in) || !runSummary.readState(in) ||
+       !runProfile.readState(in)){
+        std::cerr << "The checkpoint " << fn << " could not be read." << std::endl;
+        return false;
+    }
+    return true;
 }
 
 /**
  * @brief Converts a Newick tree input into the Species Tree class.
  *
  * @param spTreeStr input Newick string
- * @return SpeciesTree* pointer to SpeciesTree class
+ * @return SpeciesTree* pointer to SpeciesTree class, nullptr if the Newick string could not be read
  */
 SpeciesTree* Engine::buildTreeFromNewick(const std::string& spTreeStr){
-    SpeciesTree* spTree = nullptr;
-    Node* currNode = nullptr;
-    Node* prevNode = nullptr;
-    std::string commentlessSpTreeStr;
-    commentlessSpTreeStr = spTreeStr;
-    commentlessSpTreeStr = stripCommentsFromNewickTree(commentlessSpTreeStr);
-    numTaxa = countNewickLeaves(commentlessSpTreeStr);
-    commentlessSpTreeStr = formatTipNamesFromNewickTree(commentlessSpTreeStr);
-    spTree = new SpeciesTree(&rando, numTaxa);
-    currNode = new Node();
-    spTree->setRoot(currNode);
-    currNode->setAsRoot(true);
-
-    enum {
-        Prev_Tok_LParen		= 0x01,	// previous token was a left parenthesis ('(')
-        Prev_Tok_RParen		= 0x02,	// previous token was a right parenthesis (')')
-        Prev_Tok_Colon		= 0x04,	// previous token was a colon (':')
-        Prev_Tok_Comma		= 0x08,	// previous token was a comma (',')
-        Prev_Tok_Name		= 0x10,	// previous token was a node name (e.g. '2', 'P._articulata')
-        Prev_Tok_EdgeLen	= 0x20	// previous token was an edge length (e.g. '0.1', '1.7e-3')
-    };
-    unsigned previous = Prev_Tok_LParen;
-
-    // Some useful flag combinations
-    unsigned LParen_Valid = (Prev_Tok_LParen | Prev_Tok_Comma);
-    unsigned RParen_Valid = (Prev_Tok_RParen | Prev_Tok_Name | Prev_Tok_EdgeLen);
-    unsigned Comma_Valid  = (Prev_Tok_RParen | Prev_Tok_Name | Prev_Tok_EdgeLen);
-    unsigned Colon_Valid  = (Prev_Tok_RParen | Prev_Tok_Name);
-    unsigned Name_Valid   = (Prev_Tok_RParen | Prev_Tok_LParen | Prev_Tok_Comma);
-    std::string::const_iterator newickStart = commentlessSpTreeStr.begin();
-    std::string::const_iterator it = newickStart;
-
-    for(; it != commentlessSpTreeStr.end(); ++it){
-        char ch = (*it);
-        if(iswspace(ch))
-            continue;
-        switch(ch){
-            case ';': {
-                std::cout << "Species tree read in successfully.\n";
-                break;
-            }
-            case '(': {
-                if(!(previous & LParen_Valid)){
-                    std::cerr << "Your newick tree is not formatted properly. Exiting...\n";
-                    std::cerr << "A left parenthetical is not in the right place maybe...\n";
-                    exit(1);
-                }
-                prevNode = currNode;
-                currNode =  new Node();
-                currNode->setAnc(prevNode);
-                prevNode->setLdes(currNode);
-                previous = Prev_Tok_LParen;
-                break;
-            }
-            case ':': {
-                if(!(previous & Colon_Valid)){
-                    std::cerr << "Your newick tree is not formatted properly. Exiting...\n";
-                    std::cerr << "A colon appears to be in the wrong place...\n";
-                    exit(1);
-                }
-                previous = Prev_Tok_Colon;
-                break;
-            }
-            case ')': {
-                if(!(previous & RParen_Valid)){
-                    std::cerr << "Your newick tree is not formatted properly. Exiting...\n";
-                    std::cerr << "A right parenthetical is not in the right place maybe...\n";
-                    exit(1);
-                }
-                currNode = currNode->getAnc();
-                previous = Prev_Tok_RParen;
-                break;
-            }
-            case ',': {
-                if(!(previous & Comma_Valid)){
-                    std::cerr << "Your newick tree is not formatted properly. Exiting...\n";
-                    std::cerr << "A comma is not in the right place maybe...\n";
-                    exit(1);
-                }
-                prevNode = currNode;
-                currNode = new Node();
-                prevNode->setSib(currNode);
-                currNode->setSib(prevNode);
-                currNode->setAnc(prevNode->getAnc());
-                prevNode->getAnc()->setRdes(currNode);
-
-                previous = Prev_Tok_Comma;
-                break;
-            }
-            case '\'': {
-                std::string tipname;
-                for (++it; it != commentlessSpTreeStr.end(); ++it){
-                    ch = *it;
-                    if (ch == '\''){
-                        break;
-                    }
-                    else if (iswspace(ch))
-                        tipname += ' ';
-                    else
-                        tipname += ch;
-                }
-                if(previous == Prev_Tok_RParen){
-                    //prevNode->setIsTip(true);
-                //    prevNode->setName(tipname);
-                }
-                else if(previous == Prev_Tok_Comma){
-                    currNode->setIsTip(true);
-                    currNode->setName(tipname);
-                }
-                else if(previous == Prev_Tok_LParen){
-                    currNode->setName(tipname);
-                    currNode->setIsTip(true);
-                }
-
-                previous = Prev_Tok_Name;
-                break;
-            }
-            default: {
-                // branch length
-                if(previous == Prev_Tok_Colon){
-                    std::string::const_iterator jit = it;
-                    for (; it != commentlessSpTreeStr.end(); ++it){
-                        ch = *it;
-                        if (ch == ',' || ch == ')' || iswspace(ch)){
-                            --it;
-                            break;
-                        }
-                        bool valid = (ch =='e' || ch == 'E' || ch =='.' || ch == '-' || ch == '+' || isdigit(ch));
-                        if (!valid){
-                            std::cerr << "Invalid branch length character in tree description\n";
-                            exit(1);
-                        }
-                        std::string edge_length_str = std::string(jit,it+1);
-                        currNode->setBranchLength(atof(edge_length_str.c_str()));
-                        if (currNode->getBranchLength() < 1.e-10)
-                            currNode->setBranchLength(1.e-10);
-                        previous = Prev_Tok_EdgeLen;
-                    }
-                }
-                else{
-                    // Get the node name
-                    std::string tipname;
-                    for (; it != commentlessSpTreeStr.end(); ++it){
-                        ch = *it;
-                        if (ch == '('){
-                            std::cerr << "Didn't expect a left parenthesis here! Check your newick tree...\n";
-                            std::cerr << "Exiting... :(\n";
-                            exit(1);
-                        }
-                        if (iswspace(ch) || ch == ':' || ch == ',' || ch == ')'){
-                            --it;
-                            break;
-                        }
-                        tipname += ch;
-                    }
-
-                    // Expect node name only after a left paren (child's name), a comma (sib's name) or a right paren (parent's name)
-                    if (!(previous & Name_Valid)){
-                        std::cerr << "Unexpected placement of name of tip. Exiting...\n";
-                        exit(1);
-                    }
-                    currNode->setIsTip(true);
-                    currNode->setName(tipname);
-                    previous = Prev_Tok_Name;
-                }
-                if(it == commentlessSpTreeStr.end())
-                    break;
-            }
-
-        }
-
+    NewickParser parser;
+    SpeciesTree *spTree = parser.parseSpeciesTree(spTreeStr, &rando);
+    if(spTree == nullptr){
+        std::cerr << "Your newick tree is not formatted properly. " << parser.getErrorMessage() << std::endl;
+        return nullptr;
     }
-    spTree->popNodes();
-    spTree->setTreeInfo();
+    numTaxa = parser.getNumTips();
+    std::cout << "Species tree read in successfully.\n";
     return spTree;
 }
 /**
  * @brief Called from doRunRun if Species tree is read in, simulates a locus tree, then gene trees.
  *
- *
+ * @return false if the input species tree could not be read
  */
-void Engine::doRunSpTreeSet(){
+bool Engine::doRunSpTreeSet(){
 
     std::cout << "Setting species tree to this newick tree: " << inputSpTree << std::endl;
 
-    TreeInfo *ti = nullptr;
-    auto *treesim = new Simulator(&rando,
-                                        numTaxa,
-                                        spBirthRate,
-                                        spDeathRate,
-                                        1.0,
-                                        numLoci,
-                                        geneBirthRate,
-                                        geneDeathRate,
-                                        transferRate,
-                                        individidualsPerPop,
-                                        populationSize,
-                                        generationTime,
-                                        numGenes,
-                                        outgroupFrac,
-                                        treescale,
-                                        printOutputToScreen);
-
-
-    treesim->setSpeciesTree(this->buildTreeFromNewick(inputSpTree));
-    treesim->simLocusGeneTrees();
+    SpeciesTree *spTree = this->buildTreeFromNewick(inputSpTree);
+    if(spTree == nullptr)
+        return false;
+
+    RunTrace trace(tracing ? 1 : 0);
+    Simulator *treesim = this->newSimulator(&rando, printOutputToScreen);
+    treesim->setTrace(trace.getBuffer(0), 0);
+    TreeInfo *ti = this->simulateOnSpeciesTree(spTree, numTaxa, 0, treesim);
+    delete treesim;
+    delete spTree;
+    this->addToRunSummary(ti, runSummary);
+    simSpeciesTrees.push_back(ti);
+
+    this->writeTreeFiles(trace.getBuffer(0));
+    this->writeRunSummary((unsigned) simSpeciesTrees.size());
+    this->writeRunProfile();
+    this->writeRunTrace(trace);
+    return true;
+}
 
+/**
+ * @brief Simulates locus and gene trees on each species tree of a NEXUS or Newick file
+ * @details Trees are taken from the file one at a time and only read when a worker is free to simulate on them.
+ *          Each tree gets its own random number generator seeded from the Engine's, with the seeds drawn in the order
+ *          of the trees in the file, so the results do not depend on the number of threads. The files of each tree are
+ *          written as soon as it is done, indexed by the position of the tree in the file, and the TreeInfo is freed.
+ *          Trees that can not be read are reported and skipped.
+ *
+ * @return false if the file could not be read or no tree was simulated on
+ */
+bool Engine::doRunSpTreeFile(){
+    TreeFileReader reader;
+    if(!reader.openFile(inputSpTreeFile)){
+        std::cerr << reader.getErrorMessage() << std::endl;
+        return false;
+    }
+    std::cout << "Simulating locus and gene trees on the species trees in " << inputSpTreeFile << std::endl;
+
+    unsigned nThreads = (numThreads > 1) ? numThreads : 1;
+    std::vector<RunSummary> threadSummaries(nThreads);
+    std::vector<RunProfile> threadProfiles(nThreads);
+    RunTrace trace(tracing ? nThreads : 0);
+    std::mutex readerMutex;
+    unsigned numTreesDone = 0;
+    bool fileError = false;
+    // the number of trees in the file is only known once it has been read to the end
+    SimProgress prog(0);
+    if(printOutputToScreen){
+        progress = &prog;
+        prog.start();
+    }
 
-    ti =  new TreeInfo(0, numLoci);
+    auto runTrees = [&](unsigned t){
+        const char *begin = nullptr, *end = nullptr;
+        std::string name;
+        std::shared_ptr<const TranslateTable> translate;
+        seedType sd1, sd2;
+        int indx;
+        // each worker reuses one Simulator for its trees, reseeding its generator for every tree
+        MbRandom treeRando;
+        std::unique_ptr<Simulator> treesim(this->newSimulator(&treeRando, printOutputToScreen && nThreads == 1));
+        while(true){
+            {
+                std::lock_guard<std::mutex> lock(readerMutex);
+                if(fileError)
+                    return;
+                if(!reader.nextTree(begin, end, name)){
+                    fileError = !reader.getErrorMessage().empty();
+                    return;
+                }
+                indx = (int) reader.getNumTreesRead() - 1;
+                translate = reader.getTranslateTable();
+                this->drawReplicateSeeds(sd1, sd2);
+            }
+            treeRando.setSeed(sd1, sd2);
+            NewickParser parser;
+            parser.setTranslateTable(translate.get());
+            SpeciesTree *spTree = parser.parseSpeciesTree(begin, end, &treeRando);
+            if(spTree == nullptr){
+                std::lock_guard<std::mutex> lock(readerMutex);
+                std::cerr << "Species tree " << indx << " " << name << " could not be read, skipping it. ";
+                std::cerr << parser.getErrorMessage() << std::endl;
+                continue;
+            }
+            treesim->setTrace(trace.getBuffer(t), indx);
+            TreeInfo *ti = this->simulateOnSpeciesTree(spTree, parser.getNumTips(), indx, treesim.get());
+            delete spTree;
+            this->addToRunSummary(ti, threadSummaries[t]);
+            this->writeTreeInfoFiles(ti, indx, trace.getBuffer(t));
+            this->addToRunProfile(ti, threadProfiles[t]);
+            delete ti;
+            prog.addReplicate();
+            std::lock_guard<std::mutex> lock(readerMutex);
+            numTreesDone++;
+        }
+    };
+
+    if(nThreads == 1)
+        runTrees(0);
+    else{
+        std::vector<std::thread> workers;
+        for(unsigned t = 0; t < nThreads; t++)
+            workers.emplace_back(runTrees, t);
+        for(auto & w : workers)
+            w.join();
+    }
+    prog.finish();
+    progress = nullptr;
+    if(fileError)
+        std::cerr << reader.getErrorMessage() << std::endl;
+
+    for(auto & ts : threadSummaries)
+        runSummary.merge(ts);
+    for(auto & tp : threadProfiles)
+        runProfile.merge(tp);
+    this->writeRunSummary(numTreesDone);
+    this->writeRunProfile();
+    this->writeRunTrace(trace);
+    return !fileError && numTreesDone > 0;
+}
+
+/**
+ * @brief Simulates locus trees and gene trees on a species tree and stores the results in a TreeInfo
+ * @details Only uses settings of the Engine that do not change during a run, so it can be called from several threads.
+ *          The trees left in the Simulator by its last species tree are cleared first, keeping their memory for this one.
+ *
+ * @param spTree species tree to simulate on, still owned by the caller
+ * @param ntax number of tips of the species tree
+ * @param rep index of the species tree in the run
+ * @param treesim Simulator created by newSimulator
+ * @return TreeInfo* with the trees and statistics of the simulation
+ */
+TreeInfo* Engine::simulateOnSpeciesTree(SpeciesTree *spTree, unsigned ntax, int rep, Simulator *treesim){
+    TraceSpan span(treesim->getTrace(), "replicate", rep);
+    auto *ti = new TreeInfo(rep, numLoci);
+    SimProfile *prof = profiling ? &ti->getProfile() : nullptr;
+    treesim->reset();
+    treesim->setNumTaxa(ntax);
+    treesim->setProfile(prof);
+
+    treesim->setSpeciesTree(spTree);
+    treesim->simLocusGeneTrees();
+    treesim->setProfile(nullptr);
+    ti->setPeakNodes(treesim->getPeakNodes());
+    if(treesim->isOverBudget()){
+        ti->setAborted(treesim->getMaxNodes());
+        return ti;
+    }
+
+    SimProfile::Timer timer(prof, SimProfile::Phase_Printing);
+    if(statsToCalc)
+        ti->setSpeciesTreeStatistics(treesim->calcSpeciesTreeStatistics());
     ti->setWholeTreeStringInfo(treesim->printSpeciesTreeNewick());
-    ti->setSpeciesTreeDepth(treesim->calcSpeciesTreeDepth());
     ti->setExtSpeciesTreeDepth(treesim->calcExtantSpeciesTreeDepth());
     ti->setNumberTransfers(treesim->findNumberTransfers());
+    ti->setNumberDuplications(treesim->findNumberDuplications());
+    ti->setNumberLosses(treesim->findNumberLosses());
+    this->setTreeLengthStats(ti, treesim);
     for(int i = 0; i < numLoci; i++){
         ti->setLocusTreeByIndx(i, treesim->printLocusTreeNewick(i));
         if(simType == 3){
             for(int j = 0; j < numGenes; j++){
                 ti->setGeneTreeByIndx(i, j, treesim->printGeneTreeNewick(i, j));
+                if(statsToCalc)
+                    ti->setGeneTreeStatisticsByIndx(i, j, treesim->calcGeneTreeStatistics(i, j));
+                if(statsToCalc & TreeStatistics::Stat_Discordance)
+                    ti->setGeneTreeDiscordanceByIndx(i, j, treesim->calcGeneTreeDiscordance(i, j));
                 ti->setExtantGeneTreeByIndx(i, j, treesim->printExtantGeneTreeNewick(i, j));
-
             }
         }
     }
-    simSpeciesTrees.push_back(ti);
-    delete treesim;
-
-    this->writeTreeFiles();
+    return ti;
+}
 
+/**
+ * @brief Draws the two seeds of the random number generator of a replicate from the Engine's random number generator
+ *
+ * @param sd1 first seed
+ * @param sd2 second seed
+ */
+void Engine::drawReplicateSeeds(seedType &sd1, seedType &sd2){
+    sd1 = 1 + (seedType) (rando.uniformRv() * 2147483646.0);
+    sd2 = 1 + (seedType) (rando.uniformRv() * 2147483646.0);
 }
 
 void Engine::setInputSpeciesTree(const std::string &stNewick) { inputSpTree = stNewick; }
 
+void Engine::setInputSpeciesTreeFile(const std::string &stFile) { inputSpTreeFile = stFile; }
+
+void Engine::setSweepFile(const std::string &swFile) { sweepFile = swFile; }
+
 
 /**
  * @brief Constructor of TreeInfo class used to store simulated information.
@@ -493,6 +1017,8 @@ void Engine::setInputSpeciesTree(const std::string &stNewick) { inputSpTree = st
 TreeInfo::TreeInfo(int idx, int nl){
     geneTrees.resize(nl);
     extGeneTrees.resize(nl);
+    geneTreeStats.resize(nl);
+    geneTreeDiscord.resize(nl);
     spTreeLength = 0.0;
     extSpTreeLength = 0.0;
     spTreeDepth = 0.0;
@@ -504,9 +1030,15 @@ TreeInfo::TreeInfo(int idx, int nl){
     loTreeNess = 0.0;
     loAveTipLen = 0.0;
     aveTMRCAGeneTree = 0.0;
-    numTransfers = 0;
-    numDuplications = 0;
-    numLosses = 0;
+    numTransfers = 0.0;
+    numDuplications = 0.0;
+    numLosses = 0.0;
+    gsaRestarts = 0;
+    profile.setReplicate(idx);
+    gsaWastedEvents = 0;
+    aborted = false;
+    peakNodes = 0;
+    maxNodes = 0;
 }
 
 /**
@@ -518,16 +1050,33 @@ TreeInfo::~TreeInfo(){
     locusTrees.clear();
     geneTrees.clear();
     extGeneTrees.clear();
+    geneTreeStats.clear();
+    geneTreeDiscord.clear();
     speciesTree.clear();
 }
 
+/**
+ * @brief Writes the file recording a replicate aborted over the node budget, in place of its tree files
+ *
+ * @param spIndx index of the replicate
+ * @param ofp string of the outfile prefix
+ */
+void TreeInfo::writeAbortedFile(int spIndx, const std::string &ofp){
+    std::ofstream out(ofp + "_" + std::to_string(spIndx) + ".aborted.txt");
+    out << "Replicate aborted over the node budget\n";
+    out << "Node budget\t" << maxNodes << "\n";
+    out << "Nodes used\t" << peakNodes << "\n";
+    out << "Memory used (bytes)\t" << peakNodes * Tree::bytesPerNode << std::endl;
+}
+
 /**
  * @brief writes a tree stats file out
  *
  * @param spIndx index of the simulation to write the statistics out of
  * @param ofp string of the outfile prefix
+ * @param statsSel bits of the tree shape statistics selected with -stats
  */
-void TreeInfo::writeTreeStatsFile(int spIndx, std::string ofp){
+void TreeInfo::writeTreeStatsFile(int spIndx, std::string ofp, unsigned statsSel){
     std::string path;
     std::string fn = std::move(ofp);
     std::stringstream tn;
@@ -550,8 +1099,48 @@ void TreeInfo::writeTreeStatsFile(int spIndx, std::string ofp){
 
     tn.clear();
     tn.str(std::string());
-    // tn << getSpeciesAveTipLen();
-    // out << "Average branch length: " << tn.str() << std::endl;
+    tn << getSpeciesTreeLength();
+    out << "Tree length\t" << tn.str() << std::endl;
+
+    tn.clear();
+    tn.str(std::string());
+    tn << getSpeciesTreeNess();
+    out << "Treeness\t" << tn.str() << std::endl;
+
+    tn.clear();
+    tn.str(std::string());
+    tn << getSpeciesAveTipLen();
+    out << "Average tip length\t" << tn.str() << std::endl;
+
+    out << "GSA restarts\t" << getGSARestarts() << std::endl;
+    out << "GSA wasted events\t" << getGSAWastedEvents() << std::endl;
+
+    if(!locusTrees.empty()){
+        tn.clear();
+        tn.str(std::string());
+        tn << getLocusTreeLength();
+        out << "Average locus tree length\t" << tn.str() << std::endl;
+
+        tn.clear();
+        tn.str(std::string());
+        tn << getLocusTreeNess();
+        out << "Average locus treeness\t" << tn.str() << std::endl;
+
+        tn.clear();
+        tn.str(std::string());
+        tn << getLocusAveTipLen();
+        out << "Average locus tip length\t" << tn.str() << std::endl;
+    }
+    // runs without gene trees have no TMRCA or generations
+    if(!numGenerations.empty()){
+        tn.clear();
+        tn.str(std::string());
+        tn << getAveTMRCAGeneTree();
+        out << "Average gene tree TMRCA\t" << tn.str() << std::endl;
+    }
+
+    tn.clear();
+    tn.str(std::string());
     tn << getNumberTransfers();
     out << "Avaerage Transfers\t" << tn.str() << std::endl;
     
@@ -566,14 +1155,73 @@ void TreeInfo::writeTreeStatsFile(int spIndx, std::string ofp){
     tn << getNumberLosses();
     out << "Average Losses\t" << tn.str() << std::endl;
     
-    tn.clear();
-    tn.str(std::string());
-    out << "Average generations of gene trees per locus tree" << std::endl;
-    for(int i = 0; i < locusTrees.size(); i++){
-        tn.clear();
-        tn.str(std::string());
-        tn << getNumberGenerationsByLindx(i);
-        out << "Locus Tree " << std::to_string(i) << "\t" << tn.str() << std::endl;
+    if(!numGenerations.empty()){
+        out << "Average generations of gene trees per locus tree" << std::endl;
+        for(unsigned i = 0; i < numGenerations.size(); i++){
+            tn.clear();
+            tn.str(std::string());
+            tn << getNumberGenerationsByLindx(i);
+            out << "Locus Tree " << std::to_string(i) << "\t" << tn.str() << std::endl;
+        }
+    }
+    if(statsSel)
+        writeTreeShapeStats(out, statsSel);
+}
+
+/**
+ * @brief writes the shape statistics chosen with -stats for the extant species tree and each extant gene tree
+ *
+ * @param out stats file stream
+ * @param statsSel bits of the tree shape statistics selected with -stats
+ */
+void TreeInfo::writeTreeShapeStats(std::ofstream &out, unsigned statsSel){
+    out << "Extant species tree shape statistics" << std::endl;
+    if(statsSel & TreeStatistics::Stat_Colless)
+        out << "Colless\t" << spTreeStats.getColless() << std::endl;
+    if(statsSel & TreeStatistics::Stat_Sackin)
+        out << "Sackin\t" << spTreeStats.getSackin() << std::endl;
+    if(statsSel & TreeStatistics::Stat_Gamma)
+        out << "Gamma\t" << spTreeStats.getGamma() << std::endl;
+    if(statsSel & TreeStatistics::Stat_Cherries)
+        out << "Cherries\t" << spTreeStats.getNumCherries() << std::endl;
+    if(statsSel & TreeStatistics::Stat_BranchingTimes)
+        out << "Branching times\t" << spTreeStats.printBranchingTimes() << std::endl;
+
+    bool hasGeneTrees = false;
+    for(auto & locusStats : geneTreeStats)
+        hasGeneTrees = hasGeneTrees || !locusStats.empty();
+    if(!hasGeneTrees)
+        return;
+
+    out << "Extant gene tree shape statistics" << std::endl;
+    out << "Locus\tGene";
+    if(statsSel & TreeStatistics::Stat_Colless)
+        out << "\tColless";
+    if(statsSel & TreeStatistics::Stat_Sackin)
+        out << "\tSackin";
+    if(statsSel & TreeStatistics::Stat_Gamma)
+        out << "\tGamma";
+    if(statsSel & TreeStatistics::Stat_Cherries)
+        out << "\tCherries";
+    if(statsSel & TreeStatistics::Stat_BranchingTimes)
+        out << "\tBranching times";
+    out << std::endl;
+    for(unsigned i = 0; i < geneTreeStats.size(); i++){
+        for(unsigned j = 0; j < geneTreeStats[i].size(); j++){
+            TreeStatistics &gs = geneTreeStats[i][j];
+            out << i << "\t" << j;
+            if(statsSel & TreeStatistics::Stat_Colless)
+                out << "\t" << gs.getColless();
+            if(statsSel & TreeStatistics::Stat_Sackin)
+                out << "\t" << gs.getSackin();
+            if(statsSel & TreeStatistics::Stat_Gamma)
+                out << "\t" << gs.getGamma();
+            if(statsSel & TreeStatistics::Stat_Cherries)
+                out << "\t" << gs.getNumCherries();
+            if(statsSel & TreeStatistics::Stat_BranchingTimes)
+                out << "\t" << gs.printBranchingTimes();
+            out << std::endl;
+        }
     }
 }
 
@@ -762,6 +1410,38 @@ void TreeInfo::writeExtGeneTreeFileInfo(int spIndx, int Lindx, int numGenes, std
 
 }
 
+/**
+ * @brief writes out the discordance of each gene tree of a specific locus tree with the species tree as a tab delimited table
+ * @details Distances of gene trees with fewer than two extant tips are written as NA
+ *
+ * @param spIndx replicate index
+ * @param Lindx index of locus tree within species tree of index spIndx
+ * @param ofp string of outfile prefix name
+ */
+void TreeInfo::writeGeneTreeDiscordanceFile(int spIndx, int Lindx, std::string ofp){
+    std::stringstream tn;
+    tn << ofp << "genetrees_" << spIndx << "_" << Lindx << ".disc.txt";
+
+    std::ofstream out(tn.str());
+    out << "Gene\tTips\tRF\tNormalized RF\tTriplets\tNormalized triplets\tDeep coalescences" << std::endl;
+    for(unsigned i = 0; i < geneTreeDiscord[Lindx].size(); i++){
+        Discordance &gd = geneTreeDiscord[Lindx][i];
+        out << i << "\t" << gd.getNumTips();
+        if(gd.getRFDistance() < 0)
+            out << "\tNA\tNA";
+        else
+            out << "\t" << gd.getRFDistance() << "\t" << gd.getNormRFDistance();
+        if(gd.getTripletDistance() < 0)
+            out << "\tNA\tNA";
+        else
+            out << "\t" << gd.getTripletDistance() << "\t" << gd.getNormTripletDistance();
+        if(gd.getDeepCoalescences() < 0)
+            out << "\tNA" << std::endl;
+        else
+            out << "\t" << gd.getDeepCoalescences() << std::endl;
+    }
+}
+
 
 /**
  * @brief writes out all gene trees with all taxa of a specific locus tree within a specific species tree replicate into a nexus file
@@ -6,9 +6,12 @@
 #define Engine_h
 
 #include "Simulator.h"
+#include "TreeStatistics.h"
+#include "RunSummary.h"
+#include "NewickParser.h"
+#include "TreeFileReader.h"
 #include <iostream>
 #include <fstream>
-#include <regex>
 
 /**
  * @brief Class for handling the trees and data about trees from the simulation
@@ -28,8 +31,16 @@ class TreeInfo{
             double                      extSpTreeLength, extSpTreeDepth;
             double                      loTreeLength, loTreeNess, loAveTipLen, loTreeDepth;
             double                      aveTMRCAGeneTree;
-            int                         numTransfers, numDuplications{}, numLosses{};
+            double                      numTransfers, numDuplications{}, numLosses{};
+            unsigned                    gsaRestarts;
+            unsigned long               gsaWastedEvents;
             std::vector<double>         numGenerations;
+            TreeStatistics              spTreeStats;
+            std::vector<std::vector<TreeStatistics> >   geneTreeStats;
+            std::vector<std::vector<Discordance> >      geneTreeDiscord;
+            SimProfile                  profile;
+            bool                        aborted;
+            unsigned long               peakNodes, maxNodes;
     
 
     
@@ -37,6 +48,7 @@ class TreeInfo{
                                         TreeInfo(int idx, int nl);
                                         ~TreeInfo(); 
             std::string                 getWholeSpeciesTree() { return speciesTree; }
+            SimProfile&                 getProfile() { return profile; }
             std::string                 getExtantSpeciesTree() { return extSpeciesTree; }
             std::string                 getLocusTreeByIndx(int idx) { return locusTrees[idx]; }
             std::string                 getGeneTreeByIndx(int Lidx, int idx) { return geneTrees[Lidx][idx]; }
@@ -50,16 +62,28 @@ class TreeInfo{
             double                      getLocusAveTipLen() {return loAveTipLen; }
             double                      getLocusTreeDepth() {return loTreeDepth; }
             double                      getAveTMRCAGeneTree() {return aveTMRCAGeneTree; }
-            int                         getNumberTransfers() { return numTransfers; }
-            int                         getNumberDuplications() { return numDuplications; }
-            int                         getNumberLosses() { return numLosses; }
+            double                      getNumberTransfers() { return numTransfers; }
+            double                      getNumberDuplications() { return numDuplications; }
+            double                      getNumberLosses() { return numLosses; }
             std::vector<double>         getNumberGenerations() { return numGenerations; }
+            unsigned                    getGSARestarts() { return gsaRestarts; }
+            unsigned long               getGSAWastedEvents() { return gsaWastedEvents; }
+            bool                        getAborted() { return aborted; }
+            unsigned long               getPeakNodes() { return peakNodes; }
+            unsigned long               getMaxNodes() { return maxNodes; }
             double                      getNumberGenerationsByLindx(int lindx) { return numGenerations[lindx]; }
             double                      getExtSpeciesTreeDepth() { return extSpTreeDepth; }
+            TreeStatistics&             getSpeciesTreeStatistics() { return spTreeStats; }
+            std::vector<std::vector<TreeStatistics> >&  getGeneTreeStatistics() { return geneTreeStats; }
+            std::vector<std::vector<Discordance> >&     getGeneTreeDiscordance() { return geneTreeDiscord; }
         
-            void                        setNumberTransfers(int d) { numTransfers = d; }
-            void                        setNumberDuplications(int d) { numDuplications = d; }
-            void                        setNumberLosses(int d) { numLosses = d; }
+            void                        setNumberTransfers(double d) { numTransfers = d; }
+            void                        setNumberDuplications(double d) { numDuplications = d; }
+            void                        setNumberLosses(double d) { numLosses = d; }
+            void                        setGSARestarts(unsigned n) { gsaRestarts = n; }
+            void                        setGSAWastedEvents(unsigned long n) { gsaWastedEvents = n; }
+            void                        setAborted(unsigned long budget) { aborted = true; maxNodes = budget; }
+            void                        setPeakNodes(unsigned long n) { peakNodes = n; }
             void                        setNumberGenerations(std::vector<double> ng) { numGenerations = std::move(ng); }
             void                        setWholeTreeStringInfo(std::string ts ) { speciesTree = std::move(ts); }
             void                        setExtTreeStringInfo(std::string ts) { extSpeciesTree = std::move(ts); }
@@ -76,13 +100,19 @@ class TreeInfo{
             void                        setLocusTreeDepth(double b) { loTreeDepth = b; }
             void                        setAveTMRCAGeneTree(double b) { aveTMRCAGeneTree = b; }
             void                        setExtSpeciesTreeDepth(double b) { extSpTreeDepth = b; }
-            void                        writeTreeStatsFile(int spIndx, std::string ofp);      
+            void                        setSpeciesTreeStatistics(const TreeStatistics &ts) { spTreeStats = ts; }
+            void                        setGeneTreeStatisticsByIndx(int Lindx, int indx, const TreeStatistics &ts) { geneTreeStats[Lindx].push_back(ts); }
+            void                        setGeneTreeDiscordanceByIndx(int Lindx, int indx, const Discordance &gd) { geneTreeDiscord[Lindx].push_back(gd); }
+            void                        writeTreeStatsFile(int spIndx, std::string ofp, unsigned statsSel);
+            void                        writeAbortedFile(int spIndx, const std::string &ofp);
+            void                        writeTreeShapeStats(std::ofstream &out, unsigned statsSel);
             void                        writeExtantTreeFileInfo(int spIndx, std::string ofp);                
             void                        writeWholeTreeFileInfo(int spIndx, std::string ofp);
             void                        writeLocusTreeFileInfoByIndx(int spIndx, int indx, std::string ofp);
             void                        writeGeneTreeFileInfoByIndx(int spIndx, int Lindx, int indx, std::string ofp);
             void                        writeGeneTreeFileInfo(int spIndx, int Lindx, int numgene, std::string ofp);
             void                        writeExtGeneTreeFileInfo(int spIndx, int Lindx, int numgene, std::string ofp);
+            void                        writeGeneTreeDiscordanceFile(int spIndx, int Lindx, std::string ofp);
 };      
 
 
@@ -95,9 +125,12 @@ class TreeInfo{
 class Engine{
     
     private:
+        typedef void (*ParameterSetter)(Engine &e, double x);
         
         std::string outfilename;
         std::string inputSpTree;
+        std::string inputSpTreeFile;
+        std::string sweepFile;
         std::vector<TreeInfo*> simSpeciesTrees;
         int                    simType;
         int                    numTaxa;
@@ -116,6 +149,20 @@ class Engine{
         int                    individidualsPerPop, populationSize;
         double                 generationTime;
         bool                   printOutputToScreen;
+        bool                   sampleReconstructed;
+        unsigned               dtwfSwitch;
+        unsigned               statsToCalc;
+        RunSummary             runSummary;
+        bool                   profiling;
+        RunProfile             runProfile;
+        bool                   tracing;
+        SimProgress            *progress;
+        unsigned long          maxNodes;
+        double                 maxMemory;
+        RateChanges            birthRateChanges, deathRateChanges;
+        unsigned               checkpointInterval;
+        bool                   resumeRun;
+        unsigned               numThreads;
         
     public:
         
@@ -124,17 +171,50 @@ class Engine{
                                        int popsize, double genTime, int sd1, int sd2, double ts, int reps, int ntax,
                                        int nloci, int ngen,
                                        double og, bool sout);
+                                Engine(const Engine &e);
                                 ~Engine();
-        static unsigned int            countNewickLeaves(const std::string& stNewick);
-        static std::string             stripCommentsFromNewickTree(const std::string& stNewick);
-        static std::string             formatTipNamesFromNewickTree(const std::string& stNewick);
+        Engine                  &operator=(const Engine &e) = delete;
         void                    setInputSpeciesTree(const std::string& stNewick);
+        void                    setStatsSelector(unsigned sel) { statsToCalc = sel; }
+        void                    setSampleReconstructed(bool t) { sampleReconstructed = t; }
+        void                    setDTWFSwitch(unsigned n) { dtwfSwitch = n; }
+        void                    setProfiling(bool t) { profiling = t; }
+        void                    setTracing(bool t) { tracing = t; }
+        void                    setCheckpointInterval(unsigned n) { checkpointInterval = n; }
+        void                    setResume(bool t) { resumeRun = t; }
+        void                    setMaxNodes(unsigned long n) { maxNodes = n; }
+        void                    setMaxMemory(double mb) { maxMemory = mb; }
+        void                    setRateChanges(const RateChanges &b, const RateChanges &d) { birthRateChanges = b; deathRateChanges = d; }
+        void                    setSamplingFraction(double rho) { proportionToSample = rho; }
+        void                    setInputSpeciesTreeFile(const std::string& stFile);
+        void                    setNumThreads(unsigned nth) { numThreads = nth; }
+        void                    setSweepFile(const std::string& swFile);
+        bool                    setParameter(const std::string &flag, double x);
+        static const std::vector<std::pair<std::string, ParameterSetter> > &sweepParameters();
+        void                    setSimTypeFromParameters();
         std::string             getInputSpeciesTree() { return inputSpTree; }
-        void                    doRunRun();
-        void                    doRunSpTreeSet();
-        void                    writeTreeFiles();
+        bool                    doRunRun();
+        TreeInfo                *simulateReplicate(int k, Simulator *treesim);
+        Simulator               *newSimulator(MbRandom *rng, bool sout);
+        bool                    doRunSweep();
+        bool                    readSweepTable(const std::string &fn, std::vector<std::string> &columns,
+                                               std::vector<std::vector<double> > &rows);
+        bool                    doRunSpTreeSet();
+        bool                    doRunSpTreeFile();
+        TreeInfo                *simulateOnSpeciesTree(SpeciesTree *spTree, unsigned ntax, int rep, Simulator *treesim);
+        void                    drawReplicateSeeds(seedType &sd1, seedType &sd2);
+        void                    writeTreeFiles(TraceBuffer *tb);
+        void                    writeTreeInfoFiles(TreeInfo *ti, int d, TraceBuffer *tb);
         TreeInfo                *findTreeByIndx(int i);
-        void                    calcAverageRootAgeSpeciesTrees();
+        void                    addToRunSummary(TreeInfo *ti, RunSummary &summary);
+        void                    writeRunSummary(unsigned numReps);
+        void                    addToRunProfile(TreeInfo *ti, RunProfile &rp);
+        void                    writeRunProfile();
+        void                    writeRunTrace(const RunTrace &trace);
+        std::string             getCheckpointSettings();
+        bool                    writeCheckpoint(int nextRep);
+        bool                    readCheckpoint(int &nextRep);
+        void                    setTreeLengthStats(TreeInfo *ti, Simulator *treesim);
         SpeciesTree*            buildTreeFromNewick(const std::string& spTree);
         
 };
@@ -1,5 +1,7 @@
 #include "GeneTree.h"
 #include <iostream>
+#include <cmath>
+#include <limits>
 
 /**
  * @brief Constructor of the GeneTree class inherited from the Tree class
@@ -17,6 +19,8 @@ GeneTree::GeneTree(MbRandom *p, unsigned nt, unsigned ipp, unsigned ne, double g
     individualsPerPop = ipp;
     popSize = ne;
     generationTime = genTime;
+    dtwfSwitch = 0;
+    presentTime = 0.0;
     delete root;
 }
 
@@ -37,50 +41,61 @@ GeneTree::~GeneTree() = default;
 
 
 /**
- * @brief Function that takes vector of vector of indices of loci at the present and creates a vector of class Node at the start of GeneTree simulation
+ * @brief Function that takes the indices of loci at the present and creates a vector of class Node at the start of GeneTree simulation
  *
- * @param extantLociInd Vector of a vector of indices to get the indices corresponding to extant loci
+ * @param extantLociInd Vector of indices of the extant loci, -1 standing for the outgroup
  * @param presentTime The time at present (or at end of locus tree)
  */
 
-void GeneTree::initializeTree(std::vector< std::vector<int> > extantLociInd, double presentTime){
-    for(auto & node : nodes){
-        delete node;
-        node = nullptr;
-    }
-    nodes.clear();
-    for(auto & extantNode : extantNodes){
-        delete extantNode;
-        extantNode = nullptr;
-    }
-    extantNodes.clear();
+void GeneTree::initializeTree(const std::vector<int> &extantLociInd, double presentTime){
+    // the nodes of a gene tree simulated earlier in this object are reused
+    recycleNodes();
+    this->presentTime = presentTime;
+    for(auto & lineages : lineagesInLoci)
+        lineages.clear();
     Node *p;
     int numberLociInPresent;
-    numberLociInPresent = (int) extantLociInd[0].size();
+    numberLociInPresent = (int) extantLociInd.size();
     for(int i = 0; i < numberLociInPresent; i++){
         for(int j = 0; j < individualsPerPop; j++){
-            p = new Node();
+            // the outgroup is a single lineage, further individuals would be left without an ancestor
+            if(extantLociInd[i] == -1 && j > 0)
+                break;
+            p = newNode();
             p->setDeathTime(presentTime);
-            p->setLindx(extantLociInd[0][i]);
-            p->setIndx(extantLociInd[0][i]);
+            p->setLindx(extantLociInd[i]);
+            p->setIndx(extantLociInd[i]);
             p->setLdes(nullptr);
             p->setRdes(nullptr);
             p->setAnc(nullptr);
             p->setIsExtant(true);
             p->setIsTip(true);
             p->setIsExtinct(false);
-            if(extantLociInd[0][i] == -1){
+            if(extantLociInd[i] == -1){
                 this->setOutgroup(p);
                 p->setName("OUT");
             }
             else{
-                extantNodes.push_back(p);
+                getLineagesInLocus(extantLociInd[i]).push_back(p);
             }
             nodes.push_back(p);
         }
     }
 }
 
+/**
+ * @brief Returns the lineages not yet coalesced in the locus of index indx
+ *
+ * @param indx Index of the locus in the nodes vector of the LocusTree
+ * @return Reference to the bucket of lineages of that locus
+ */
+
+std::vector<Node*>& GeneTree::getLineagesInLocus(int indx){
+    if(indx >= (int) lineagesInLoci.size())
+        lineagesInLoci.resize(indx + 1);
+    return lineagesInLoci[indx];
+}
+
 /**
  * @brief Gets the time to next coalescent event
  *
@@ -92,112 +107,116 @@ void GeneTree::initializeTree(std::vector< std::vector<int> > extantLociInd, dou
 double GeneTree::getCoalTime(int n){
     double ct;
     double lambda = (double)(n * (n - 1)) / (2 * popSize) ;
-    ct = -log(rando->uniformRv()) / (lambda);
+    ct = rando->exponentialRv(lambda);
     return ct;
 }
 
 /**
  * @brief Function that coordinates the censored coalescent process
- * @details While time is not 0, gets times to events, checks which Nodes are alive randomly selects two and deletes them adding in a new Node
+ * @details Coalesces randomly chosen pairs of the lineages in one locus at times given by getCoalTime until the
+ *          next time passes stopTime or a single lineage is left. With dtwfSwitch set, Wright-Fisher generations are
+ *          stepped first until no more than dtwfSwitch lineages are left
  *
  * @param startTime Left-bound on times based on censoring
  * @param stopTime Right-bound on times based on censoring
  * @param contempSpeciesIndx SpeciesIndx of lineage being coalesced in
- * @param ancSpIndx Index of the Ancestor of the Node of index contempSpecies Indx
- * @param chck True if last coalescent time, otherwise false
- * @return Bool indicating if number of nodes in Coalescent Process is now 1
  */
 
-bool GeneTree::censorCoalescentProcess(double startTime, double stopTime, int contempSpeciesIndx, int ancSpIndx, bool chck){
+void GeneTree::censorCoalescentProcess(double startTime, double stopTime, int contempSpeciesIndx){
+    std::vector<Node*> &lineages = getLineagesInLocus(contempSpeciesIndx);
     int leftInd, rightInd;
-    int leftIndExtN, rightIndExtN;
-    int extIndx;
     Node *l, *r;
-    Node *n;
-    double t = startTime;
-    bool allCoalesced = false;
-    // search extantNodes for members with Lindx = contempSpecisIndx
-    std::vector<int> indInExtNodes;
-    for(auto it = extantNodes.begin(); it != extantNodes.end(); ++it){
-        if((*it)->getLindx() == contempSpeciesIndx){
-            extIndx = (int) std::distance(extantNodes.begin(), it);
-            indInExtNodes.push_back(extIndx);
-        }
+    double t = wrightFisherProcess(lineages, startTime, stopTime);
+    if(dtwfSwitch > 0 && lineages.size() > dtwfSwitch)
+        return;
+    while(lineages.size() > 1){
+        t -= getCoalTime((int) lineages.size());
+        if(t < stopTime)
+            break;
+
+        rightInd = rando->uniformRv(0, lineages.size() - 1);
+        r = lineages[rightInd];
+        lineages[rightInd] = lineages.back();
+        lineages.pop_back();
+
+        leftInd = rando->uniformRv(0, lineages.size() - 1);
+        l = lineages[leftInd];
+        lineages[leftInd] = lineages.back();
+        lineages.pop_back();
+
+        lineages.push_back(coalescentEvent(t, l, r));
     }
-  //  std::cout << contempSpeciesIndx << "   ($)$)%    " << indInExtNodes.size() << std::endl;
-    if(indInExtNodes.size() > 1){
-        while(t > stopTime){
-            t -= getCoalTime((int) indInExtNodes.size());
-            // std::cout << t << std::endl;
-            if(t < stopTime){
-                {
-                    allCoalesced = chck;
-                    break;
-                }
-            }
+}
 
-            rightInd = rando->uniformRv(0, indInExtNodes.size() - 1);
-            iter_swap(indInExtNodes.begin() + rightInd, indInExtNodes.begin());
-            rightIndExtN = indInExtNodes[0];
-            r = extantNodes[rightIndExtN];
-
-            leftInd = rando->uniformRv(1, indInExtNodes.size() - 1);
-            iter_swap(indInExtNodes.begin() + leftInd, indInExtNodes.begin() + 1);
-            leftIndExtN = indInExtNodes[1];
-            l = extantNodes[leftIndExtN];
-
-            n = coalescentEvent(t, l, r);
-            //iter_swap(extantNodes.begin() + rightIndExtN, extantNodes.end() - 1);
-            //iter_swap(extantNodes.begin() + leftIndExtN, extantNodes.end() - 2);
-            if(leftIndExtN > rightIndExtN){
-                extantNodes.erase(extantNodes.begin() + leftIndExtN);
-                extantNodes.erase(extantNodes.begin() + rightIndExtN);
-            }
-            else{
-                extantNodes.erase(extantNodes.begin() + rightIndExtN);
-                extantNodes.erase(extantNodes.begin() + leftIndExtN);
-            }
-            indInExtNodes.clear();
-            //indInExtNodes.erase(indInExtNodes.begin(), indInExtNodes.begin() + 2);
-            extantNodes.insert(extantNodes.begin(), n);
-
-            // if(!(indInExtNodes.empty())){
-            //     for(std::vector<int>::iterator it = indInExtNodes.begin(); it != indInExtNodes.end(); ++it){
-            //         (*it) += 1;
-            //     }
-            // }
-            for(auto it = extantNodes.begin(); it != extantNodes.end(); ++it){
-                if((*it)->getLindx() == contempSpeciesIndx){
-                    extIndx = (int) std::distance(extantNodes.begin(), it);
-                    indInExtNodes.push_back(extIndx);
-                }
-            }
-//            extantNodes.erase(extantNodes.end() - 2, extantNodes.end());
-         //  std::cout << "size of extantNodes " << extantNodes.size() << std::endl;
-            if(indInExtNodes.size() == 1){
-                allCoalesced = true;
-                break;
-            }
+/**
+ * @brief Steps the lineages of one locus back one discrete-time Wright-Fisher generation
+ * @details Every lineage draws its parent among the popSize individuals of the generation before, the lineages
+ *          are then sorted by parent and each group drawing the same parent is coalesced at time t. Groups of more
+ *          than two are joined by binary coalescences at the same time
+ *
+ * @param lineages lineages of the locus, replaced by their parents
+ * @param t time of the generation of the parents
+ */
+
+void GeneTree::wrightFisherGeneration(std::vector<Node*> &lineages, double t){
+    parentDraws.clear();
+    for(auto & lineage : lineages)
+        parentDraws.emplace_back((unsigned) (rando->uniformRv() * popSize), lineage);
+    std::stable_sort(parentDraws.begin(), parentDraws.end(),
+                     [](const std::pair<unsigned, Node*> &a, const std::pair<unsigned, Node*> &b){ return a.first < b.first; });
+    lineages.clear();
+    Node *p = parentDraws[0].second;
+    for(size_t i = 1; i < parentDraws.size(); i++){
+        if(parentDraws[i].first == parentDraws[i - 1].first)
+            p = coalescentEvent(t, p, parentDraws[i].second);
+        else{
+            lineages.push_back(p);
+            p = parentDraws[i].second;
         }
     }
-    else if (indInExtNodes.size() == 1){
-        allCoalesced = true;
-        extantNodes[indInExtNodes[0]]->setLindx(ancSpIndx);
-    }
-    else{
-        // std::cout << "this shouldn't even be happnening" << std::endl;
-        allCoalesced = true;
-    }
+    lineages.push_back(p);
+}
 
-    if(allCoalesced){
-        for(int indInExtNode : indInExtNodes){
-          //  std::cout << "**************" << std::endl;
-            extantNodes[indInExtNode]->setLindx(ancSpIndx);
-        }
+/**
+ * @brief Steps Wright-Fisher generations back from startTime while more than dtwfSwitch lineages are left
+ * @details Generations fall one time unit apart counting back from presentTime, the unit getCoalTime works in,
+ *          so intervals split at epochs see the same generations as one long interval would
+ *
+ * @param lineages lineages of the locus
+ * @param startTime Left-bound on times based on censoring
+ * @param stopTime Right-bound on times based on censoring, generations before it are left for the next interval
+ * @return time of the last generation stepped, startTime if there was none
+ */
+
+double GeneTree::wrightFisherProcess(std::vector<Node*> &lineages, double startTime, double stopTime){
+    double t = startTime;
+    if(dtwfSwitch == 0)
+        return t;
+    double gen = std::floor(presentTime - startTime) + 1.0;
+    while(lineages.size() > dtwfSwitch && presentTime - gen >= stopTime){
+        t = presentTime - gen;
+        wrightFisherGeneration(lineages, t);
+        gen += 1.0;
     }
+    return t;
+}
 
-    indInExtNodes.clear();
-    return allCoalesced;
+/**
+ * @brief Moves the lineages left in a locus into its ancestor once the birth of the locus is reached
+ *
+ * @param contempSpeciesIndx Index of the locus that was born
+ * @param ancSpIndx Index of the ancestor of that locus
+ */
+
+void GeneTree::moveLineagesToAncestor(int contempSpeciesIndx, int ancSpIndx){
+    // the ancestor is taken first, growing the buckets would leave a reference to the locus dangling
+    std::vector<Node*> &ancLineages = getLineagesInLocus(ancSpIndx);
+    std::vector<Node*> &lineages = getLineagesInLocus(contempSpeciesIndx);
+    for(auto & lineage : lineages){
+        lineage->setLindx(ancSpIndx);
+        ancLineages.push_back(lineage);
+    }
+    lineages.clear();
 }
 
 /**
@@ -211,7 +230,7 @@ bool GeneTree::censorCoalescentProcess(double startTime, double stopTime, int co
  */
 
 Node* GeneTree::coalescentEvent(double t, Node *p, Node *q){
-    Node *n = new Node();
+    Node *n = newNode();
     n->setDeathTime(t);
     n->setLdes(p);
     n->setRdes(q);
@@ -257,7 +276,7 @@ std::multimap<int, double> GeneTree::rescaleTimes(const std::multimap<int, doubl
 
 /**
  * @brief Coalescent process that occurs at the root
- * @details Loops through any remaining nodes and coalesces them at times given by getCoalTime. Note that this means negative branch lengths are possible - these indicate events occuring within the stem.
+ * @details Loops through any remaining nodes and coalesces them at times given by getCoalTime, after any Wright-Fisher generations stepped by wrightFisherProcess. Note that this means negative branch lengths are possible - these indicate events occuring within the stem.
  *
  * @todo get rid of ogf because it is clunky and doesn't work?
  * @param startTime time of root (final left-bound)
@@ -268,12 +287,15 @@ void GeneTree::rootCoalescentProcess(double startTime, double ogf){
     int leftInd, rightInd;
     Node *l, *r;
     Node *n;
-    double t = startTime;
-    // search extantNodes for members with Lindx = contempSpecisIndx
-    std::vector<int> indInExtNodes;
-    for(auto & extantNode : extantNodes){
-        extantNode->setLindx(0);
+    extantNodes.clear();
+    for(auto & lineages : lineagesInLoci){
+        for(auto & lineage : lineages){
+            lineage->setLindx(0);
+            extantNodes.push_back(lineage);
+        }
+        lineages.clear();
     }
+    double t = wrightFisherProcess(extantNodes, startTime, -std::numeric_limits<double>::infinity());
     while(extantNodes.size() > 1){
         t -= getCoalTime((int) extantNodes.size());
 
@@ -293,7 +315,7 @@ void GeneTree::rootCoalescentProcess(double startTime, double ogf){
         this->setRoot(extantNodes[0]);
     }
     else{
-        Node *nRoot = new Node();
+        Node *nRoot = newNode();
         t -= getCoalTime(2);
         extantNodes[0]->setBirthTime(t);
         nRoot->setBirthTime(t);
@@ -364,9 +386,10 @@ void GeneTree::setBranchLengths(){
  */
 
 void GeneTree::addExtinctSpecies(double bt, int indx){
+    std::vector<Node*> &lineages = getLineagesInLocus(indx);
     Node *p;
     for(int i = 0; i < individualsPerPop; i++){
-        p = new Node();
+        p = newNode();
         p->setDeathTime(bt);
         p->setIndx(indx);
         p->setLindx(indx);
@@ -376,7 +399,7 @@ void GeneTree::addExtinctSpecies(double bt, int indx){
         p->setIsExtant(false);
         p->setIsTip(true);
         p->setIsExtinct(true);
-        extantNodes.push_back(p);
+        lineages.push_back(p);
         nodes.push_back(p);
 
     }
@@ -423,51 +446,42 @@ std::string GeneTree::printNewickTree(){
 }
 
 /**
- * @brief Prints tree found in GeneTree class with only extant tips
- *
- * @todo redundant code; delete!
- * @return Newick string of the tree
+ * @brief Printing function for the extant gene tree
+ * @details Lineages whose tips all come from extinct loci are left out by walking the view set by setExtantView,
+ *          the gene tree itself is not changed
+ * @return Newick string of the extant gene tree
  */
 std::string GeneTree::printExtantNewickTree(){
     std::stringstream ss;
-    recGetNewickTree(this->getRoot(), ss);
+    Node *r = setExtantView();
+    if(r != nullptr)
+        recGetExtNewickTree(r, ss);
     ss << ";";
     std::string geneTreeString = ss.str();
     return geneTreeString;
 }
 
-
+/**
+ * @brief Recursively writes the Newick string of the extant gene tree below p
+ *
+ * @param p Node of the extant tree to be written to ss
+ * @param ss stringstream of the string to be printed out
+ */
 void GeneTree::recGetExtNewickTree(Node *p, std::stringstream &ss){
-    if(p->getRdes() == nullptr){
-        if(p->getIsExtant())
-            ss << p->getName();
-    }
+    if(p->getRdes() == nullptr)
+        ss << p->getName();
     else{
-    // if(p != NULL){
-        int flag = p->getFlag();
-        if(flag == 2){
-            ss << "(";
-            recGetExtNewickTree(p->getRdes(), ss);
-            ss << "[&index=" << p->getRdes()->getIndex() << "]" << ":" << p->getRdes()->getBranchLength();
-            ss << ",";
-            recGetExtNewickTree(p->getLdes(), ss);
-            ss << "[&index=" << p->getLdes()->getIndex() << "]" << ":" << p->getLdes()->getBranchLength();
-            ss << ")";
-        }
-        else{
-            // if(p->getRdes() == NULL){
-            //     ss << p->getName();
-            // }
-            // else{
-            if(p->getLdes()->getIsExtinct()){
-                recGetExtNewickTree(p->getRdes(), ss);
-            }
-            if(p->getRdes()->getIsExtinct()){
-                recGetExtNewickTree(p->getLdes(), ss);
-            }
-            //}
-        }
-   }
+        double brlen;
+        Node *q = nextNodeInExtantView(p->getRdes(), brlen);
+        ss << "(";
+        recGetExtNewickTree(q, ss);
+        ss << "[&index=" << q->getIndex() << "]" << ":" << brlen;
+        ss << ",";
+        q = nextNodeInExtantView(p->getLdes(), brlen);
+        recGetExtNewickTree(q, ss);
+        ss << "[&index=" << q->getIndex() << "]" << ":" << brlen;
+        ss << ")";
+    }
 }
 
 /**
@@ -503,6 +517,10 @@ void GeneTree::setTreeTipNames(){
     std::string name;
     int indx;
     for(auto & node : nodes){
+        if(node == this->getOutgroup()){
+            node->setName("OUT");
+            continue;
+        }
         if(node->getIsTip()){
             indx  = node->getIndex();
             tn << indx;
@@ -514,10 +532,7 @@ void GeneTree::setTreeTipNames(){
             name += "_" + tn.str();
             tn.clear();
             tn.str(std::string());
-            if(node == this->getOutgroup())
-                node->setName("OUT");
-            else
-                node->setName(name);
+            node->setName(name);
             if(indNumber == individualsPerPop)
                 indNumber = 0;
         }
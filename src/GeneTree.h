@@ -12,14 +12,23 @@ class GeneTree : public Tree {
         unsigned individualsPerPop; //! individuals per population to be sampled in coalescent functions
         unsigned popSize; //! population size used in the getCoalTime function
         double   generationTime; //! specified in generations per year
+        unsigned dtwfSwitch; //! Wright-Fisher generations are stepped while more lineages than this are left, 0 for the Kingman coalescent only
+        double   presentTime; //! time at present, Wright-Fisher generations are counted back from it
+        std::vector<std::vector<Node*> > lineagesInLoci; //! lineages not yet coalesced, bucketed by the locus index they are in
+        std::vector<std::pair<unsigned, Node*> > parentDraws; //! scratch parents drawn for the lineages in wrightFisherGeneration
+        std::vector<Node*>& getLineagesInLocus(int indx);
+        void        wrightFisherGeneration(std::vector<Node*> &lineages, double t);
+        double      wrightFisherProcess(std::vector<Node*> &lineages, double startTime, double stopTime);
 
     public:
                     GeneTree(MbRandom *rando, unsigned nt, unsigned ipp, unsigned ne, double genTime);
                     ~GeneTree() override;
+        void        setDTWFSwitch(unsigned n) { dtwfSwitch = n; }
         double      getCoalTime(int n);
         Node*       coalescentEvent(double t, Node *p, Node *q);
-        bool        censorCoalescentProcess(double startTime, double stopTime, int contempSpIndx, int newSpIndx, bool chck);
-        void        initializeTree(std::vector< std::vector<int> > extantLociIndx, double presentTime);
+        void        censorCoalescentProcess(double startTime, double stopTime, int contempSpIndx);
+        void        moveLineagesToAncestor(int contempSpIndx, int ancSpIndx);
+        void        initializeTree(const std::vector<int> &extantLociIndx, double presentTime);
         std::multimap<int,double> rescaleTimes(const std::multimap<int, double>& timeMap);
         void        rootCoalescentProcess(double startTime, double ogf);
         static void        recursiveRescaleTimes(Node *r, double add);
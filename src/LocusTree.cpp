@@ -32,6 +32,24 @@ LocusTree::LocusTree(MbRandom *p, unsigned nt, double stop, double gbr, double g
 
 LocusTree::~LocusTree() = default;
 
+/**
+ * @brief Puts the locus tree back to a single lineage at time 0 so it can be simulated again
+ * @details The nodes of the old tree are kept and reused by the new one instead of being freed
+ *
+ * @param stop time at which the new simulation stops
+ */
+void LocusTree::resetTree(double stop){
+    recycleNodes();
+    initializeRoot();
+    getRoot()->setLindx(0);
+    numTaxa = 1;
+    stopTime = stop;
+    currentTime = 0.0;
+    numTransfers = 0;
+    numLosses = 0;
+    numDuplications = 0;
+}
+
 /**
  * @brief Function that sets information of Node during simulation
  * @details for both left and right lineages sets information for descendants
@@ -91,8 +109,8 @@ void LocusTree::setNewLineageInfo(int indx, Node *r, Node *l){
 
 void LocusTree::lineageBirthEvent(unsigned indx){
     Node *sis, *right;
-    right = new Node();
-    sis = new Node();
+    right = newNode();
+    sis = newNode();
     setNewLineageInfo(indx, right, sis);
     numDuplications += 1;
 }
@@ -137,8 +155,8 @@ void LocusTree::lineageTransferEvent(int indx){
  //   }
     //first a birth event
     Node *donor, *rec;
-    donor = new Node();
-    rec = new Node();
+    donor = newNode();
+    rec = newNode();
     numTransfers++;
     // donor keeps all the attributes  of the Node at extantNodes[indx]
     donor->setAnc(extantNodes[indx]);
@@ -222,7 +240,7 @@ void LocusTree::lineageTransferEvent(int indx){
 double LocusTree::getTimeToNextEvent(){
     double sumrt = geneBirthRate + geneDeathRate + transferRate;
     double returnTime;
-    returnTime = -log(rando->uniformRv()) / (sumrt);
+    returnTime = rando->exponentialRv(sumrt);
     currentTime += returnTime;
     return returnTime;
 }
@@ -271,8 +289,8 @@ int LocusTree::speciationEvent(int indx, double time, std::pair<int,int> sibs){
     for(auto it = extantNodes.begin(); it != extantNodes.end();){
         lociExtNodesIndx = (*it)->getIndex();
         if(lociExtNodesIndx == indx){
-            r = new Node();
-            l = new Node();
+            r = newNode();
+            l = newNode();
             r->setLdes(nullptr);
             r->setRdes(nullptr);
             r->setSib(l);
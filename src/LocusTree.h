@@ -23,6 +23,7 @@ class LocusTree : public Tree
     public:
         LocusTree(MbRandom *rando, unsigned nt, double stop, double gbr, double gdr, double lgtr);
         ~LocusTree() override;
+        void    resetTree(double stop);
         double  getTimeToNextEvent() override;
         void    lineageBirthEvent(unsigned indx) override;
         void    lineageDeathEvent(unsigned indx) override;
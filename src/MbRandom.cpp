@@ -33,6 +33,7 @@
 
 #include <cmath>
 #include <ctime>
+#include <iomanip>
 #include <iostream>
 
 #include "MbRandom.h"
@@ -253,6 +254,122 @@ l4:
 
 }
 
+// Exponential Distribution
+
+namespace {
+
+/*!
+ * Tables of the 256 layer ziggurat for the exponential(1) distribution
+ * of Marsaglia & Tsang (2000). They are the same for every instance
+ * and are built once, the first time they are needed.
+ */
+struct ExpZigguratTables {
+
+    seedType ke[256];
+    double   we[256];
+    double   fe[256];
+
+    ExpZigguratTables(void) {
+
+        const double m2 = 4294967296.0;
+        double de = 7.697117470131487, te = de, ve = 3.949659822581572e-3;
+        double q = ve / std::exp(-de);
+        ke[0] = (seedType)((de / q) * m2);
+        ke[1] = 0;
+        we[0] = q / m2;
+        we[255] = de / m2;
+        fe[0] = 1.0;
+        fe[255] = std::exp(-de);
+        for (int i = 254; i >= 1; i--)
+        {
+            de = -std::log(ve / de + std::exp(-de));
+            ke[i+1] = (seedType)((de / te) * m2);
+            te = de;
+            fe[i] = std::exp(-de);
+            we[i] = de / m2;
+        }
+    }
+};
+
+const ExpZigguratTables& expZiggurat(void) {
+
+    static const ExpZigguratTables tables;
+    return tables;
+}
+
+}
+
+/*!
+ * This function refills the buffer of exponential(1) random variables
+ * with the ziggurat method of Marsaglia & Tsang (2000). Almost all values
+ * take one draw of the generator, a multiplication and a comparison; the
+ * logarithm and exponential are only needed in the rare slow path.
+ *
+ * @brief Refill exponential buffer.
+ * @return Returns no value.
+ * @throws Does not throw an error.
+ * @see Marsaglia & Tsang. 2000. The ziggurat method for generating
+ *      random variables. Journal of Statistical Software, 5.
+ */
+void MbRandom::fillExponentialBuffer(void) {
+
+    const ExpZigguratTables &zt = expZiggurat();
+    int nSlow = 0;
+    int slow[expBufferSize];
+    seedType slowBits[expBufferSize];
+    /* the fast path has no calls, so the generator state stays in registers */
+    seedType s1 = I1, s2 = I2;
+    for (int i = 0; i < expBufferSize; i++)
+    {
+        s1 = 36969 * (s1 & 0177777) + (s1 >> 16);
+        s2 = 18000 * (s2 & 0177777) + (s2 >> 16);
+        seedType jz = (s1 << 16)^(s2 & 0177777);
+        seedType iz = jz & 255;
+        expBuffer[i] = jz * zt.we[iz];
+        if (jz >= zt.ke[iz])
+        {
+            slow[nSlow] = i;
+            slowBits[nSlow++] = jz;
+        }
+    }
+    I1 = s1;
+    I2 = s2;
+    for (int k = 0; k < nSlow; k++)
+        expBuffer[slow[k]] = exponentialZigguratTail(slowBits[k]);
+    expBufferPos = 0;
+
+}
+
+/*!
+ * This function is the slow path of the exponential ziggurat, taken when
+ * the point falls outside the rectangle of its layer. It samples the tail
+ * for the base layer and otherwise accepts or rejects the point under the
+ * density, drawing new points until one is accepted.
+ *
+ * @brief Exponential ziggurat slow path.
+ * @param jz are the random bits that were rejected by the fast path.
+ * @return Returns an exponential(1) random variable.
+ * @throws Does not throw an error.
+ */
+double MbRandom::exponentialZigguratTail(seedType jz) {
+
+    const ExpZigguratTables &zt = expZiggurat();
+    seedType iz = jz & 255;
+    for (;;)
+    {
+        if (iz == 0)
+            return 7.697117470131487 - std::log((randomBits() + 1.0) * 2.328306436538696e-10);
+        double x = jz * zt.we[iz];
+        if (zt.fe[iz] + uniformRv() * (zt.fe[iz-1] - zt.fe[iz]) < std::exp(-x))
+            return x;
+        jz = randomBits();
+        iz = jz & 255;
+        if (jz < zt.ke[iz])
+            return jz * zt.we[iz];
+    }
+
+}
+
 #pragma mark Gamma Distribution
 
 /*!
@@ -1278,6 +1395,7 @@ void MbRandom::setSeed(void) {
     seedType x = (seedType)( time( 0 ) );
     I1 = x & 0xFFFF;
     I2 = x >> 16;
+    expBufferPos = expBufferSize;
 
 }
 
@@ -1304,6 +1422,7 @@ void MbRandom::setSeed(seedType seed1, seedType seed2) {
         I1 = seed1;
         I2 = seed2;
     }
+    expBufferPos = expBufferSize;
 
 }
 
@@ -1323,6 +1442,63 @@ void MbRandom::getSeed(seedType& i1, seedType& i2) {
 
 }
 
+/*!
+ * This function writes the full state of the generator on one line: the
+ * two seeds, the cached normal random variable, and the unused part of the
+ * buffer of exponential random variables. Doubles are written with 17
+ * significant digits so that the state is restored exactly.
+ *
+ * @brief Writes the state of the generator.
+ * @param out is the stream to write to.
+ * @return This function does not return anything.
+ * @throws Does not throw an error.
+ */
+void MbRandom::writeState(std::ostream &out) const {
+
+    std::streamsize prec = out.precision(17);
+    out << I1 << " " << I2 << " " << availableNormalRv << " " << (availableNormalRv ? extraNormalRv : 0.0) << " " << expBufferPos;
+    for (int i = expBufferPos; i < expBufferSize; i++)
+        out << " " << expBuffer[i];
+    out << std::endl;
+    out.precision(prec);
+
+}
+
+/*!
+ * This function restores a state written by writeState, so that the
+ * generator continues the exact stream of random variables it was
+ * producing when the state was written.
+ *
+ * @brief Restores the state of the generator.
+ * @param in is the stream to read from.
+ * @return Returns false if the state could not be read, the generator is then unchanged.
+ * @throws Does not throw an error.
+ */
+bool MbRandom::readState(std::istream &in) {
+
+    seedType i1, i2;
+    bool availNormal;
+    double extraNormal;
+    int pos;
+    double buf[expBufferSize];
+    if (!(in >> i1 >> i2 >> availNormal >> extraNormal >> pos) || pos < 0 || pos > expBufferSize)
+        return false;
+    for (int i = pos; i < expBufferSize; i++)
+    {
+        if (!(in >> buf[i]))
+            return false;
+    }
+    I1 = i1;
+    I2 = i2;
+    availableNormalRv = availNormal;
+    extraNormalRv = extraNormal;
+    expBufferPos = pos;
+    for (int i = pos; i < expBufferSize; i++)
+        expBuffer[i] = buf[i];
+    return true;
+
+}
+
 /*!
  * This function calculates the log of the gamma function, which is equal to:
  * Gamma(alp) = {integral from 0 to infinity} t^{alp-1} e^-t dt
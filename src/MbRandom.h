@@ -38,6 +38,7 @@
 #define MB_RANDOM_H
 
 #include <cmath>
+#include <iosfwd>
 
 #ifndef PI
 #	define PI 3.141592653589793
@@ -72,12 +73,15 @@ public:
     void   getSeed(seedType &seed1, seedType &seed2);                                    /*!< retreives the seeds */
     void   setSeed(void);                                                                /*!< initializes the seeds using the current time */
     void   setSeed(seedType seed1, seedType seed2);                                      /*!< initializes the seeds */
+    void   writeState(std::ostream &out) const;                                          /*!< writes the full state of the generator */
+    bool   readState(std::istream &in);                                                  /*!< restores a state written by writeState */
     double   chiSquareRv(double v);                                       /* chi square */ /*!< Chi-square random variable */
     double   chiSquarePdf(double v, double x);                                             /*!< the chi-square probability density */
     double   lnChiSquarePdf(double v, double x);                                           /*!< natural log of the chi-square probability density */
     double   chiSquareCdf(double v, double x);                                             /*!< the chi-square cumulative probability */
     double   chiSquareQuantile(double prob, double v);                                     /*!< quantile of a chi square distribution */
     inline double   exponentialRv(double lambda);                               /* exponential */ /*!< exponential random variable */
+    inline double   standardExponentialRv(void);                                                  /*!< exponential(1) random variable taken from a buffer */
     inline double   exponentialPdf(double lambda, double x);                                      /*!< Exponential probability density */
     inline double   lnExponentialPdf(double lambda, double x);                                    /*!< natural log of Exponential probability density */
     inline double   exponentialCdf(double lambda, double x);                                      /*!< Exponential cumulative probability */
@@ -149,6 +153,9 @@ private:
 
     // Stuff for CPP added by TAH from MrBayes 3.2
     double   psiExp(double alpha);
+    inline seedType   randomBits(void);                                                       /*!< next 32 random bits of the generator */
+    void   fillExponentialBuffer(void);                                                    /*!< refills the buffer of exponential(1) random variables */
+    double   exponentialZigguratTail(seedType jz);                                         /*!< slow path of the exponential ziggurat */
 
     /* private data */
     seedType   I1,I2;                                                                         /*!< seed values for the random number generator */
@@ -156,6 +163,9 @@ private:
     double   facTable[1024];                                                                /*!< a table containing the log of the factorial up to 1024 */
     bool   availableNormalRv;                                                             /*!< a boolean which is true if there is a normal random variable available */
     double   extraNormalRv;                                                                 /*!< a normally-distributed random variable which */
+    static const int expBufferSize = 256;                                                  /*!< number of exponential random variables drawn at once */
+    double   expBuffer[expBufferSize];                                                      /*!< buffer of exponential(1) random variables */
+    int   expBufferPos;                                                                     /*!< position of the next unused value in expBuffer */
 
 };
 
@@ -170,7 +180,40 @@ private:
  */
 inline double MbRandom::exponentialRv(double lambda) {
 
-    return -(1.0 / lambda) * std::log( uniformRv() );
+    return standardExponentialRv() / lambda;
+
+}
+
+/*!
+ * This function returns an exponential(1) random variable. The values are
+ * drawn in blocks by fillExponentialBuffer so the cost of the
+ * ziggurat tables and of the function call is spread over many draws.
+ *
+ * \brief Standard exponential random variable.
+ * \return Returns an exponential(1) random variable.
+ * \throws Does not throw an error.
+ */
+inline double MbRandom::standardExponentialRv(void) {
+
+    if (expBufferPos == expBufferSize)
+        fillExponentialBuffer();
+    return expBuffer[expBufferPos++];
+
+}
+
+/*!
+ * This function advances the generator and returns its 32 random bits,
+ * the same bits uniformRv scales to [0,1).
+ *
+ * \brief Random bits.
+ * \return Returns 32 random bits.
+ * \throws Does not throw an error.
+ */
+inline seedType MbRandom::randomBits(void) {
+
+    I1 = 36969 * (I1 & 0177777) + (I1 >> 16);
+    I2 = 18000 * (I2 & 0177777) + (I2 >> 16);
+    return (I1 << 16)^(I2 & 0177777);
 
 }
 
@@ -0,0 +1,252 @@
+#include "NewickParser.h"
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+
+/**
+ * @brief Constructor of the NewickParser class
+ */
+NewickParser::NewickParser(){
+    first = nullptr;
+    cur = nullptr;
+    last = nullptr;
+    numTips = 0;
+    translate = nullptr;
+}
+
+/**
+ * @brief Makes a new node and keeps track of it so it can be freed if the tree turns out to be malformed
+ * @return Node* the new node
+ */
+Node* NewickParser::newNode(){
+    Node *p = new Node();
+    parsedNodes.push_back(p);
+    return p;
+}
+
+/**
+ * @brief Records an error message with the position it occurred at and frees the nodes read so far
+ *
+ * @param msg description of the error
+ * @return false so callers can return the result directly
+ */
+bool NewickParser::fail(const std::string &msg){
+    std::stringstream ss;
+    ss << msg << " at character " << (cur - first) + 1;
+    errorMsg = ss.str();
+    for(auto & p : parsedNodes)
+        delete p;
+    parsedNodes.clear();
+    return false;
+}
+
+/**
+ * @brief Moves past whitespace and comments in square brackets
+ */
+void NewickParser::skipSpaceAndComments(){
+    while(cur < last){
+        if(isspace((unsigned char) *cur))
+            ++cur;
+        else if(*cur == '['){
+            while(cur < last && *cur != ']')
+                ++cur;
+            if(cur < last)
+                ++cur;
+        }
+        else
+            break;
+    }
+}
+
+/**
+ * @brief Reads a node label, quoted labels may contain whitespace and any Newick punctuation
+ *
+ * @param label string filled with the label, empty if the node has no label
+ * @return true if the label was read, false if a quoted label is not closed
+ */
+bool NewickParser::readLabel(std::string &label){
+    label.clear();
+    if(cur < last && *cur == '\''){
+        for(++cur; cur < last; ++cur){
+            if(*cur == '\''){
+                if(cur + 1 < last && *(cur + 1) == '\''){
+                    label += '\'';
+                    ++cur;
+                }
+                else
+                    break;
+            }
+            else if(isspace((unsigned char) *cur))
+                label += ' ';
+            else
+                label += *cur;
+        }
+        if(cur >= last)
+            return fail("Quoted name is not closed");
+        ++cur;
+        return true;
+    }
+    const char *labelStart = cur;
+    while(cur < last && !isspace((unsigned char) *cur) && strchr("():,;[]", *cur) == nullptr)
+        ++cur;
+    label.assign(labelStart, cur);
+    return true;
+}
+
+/**
+ * @brief Reads the branch length after a colon, lengths below 1e-10 are set to 1e-10
+ *
+ * @param p node the branch length belongs to
+ * @return true if a valid number was read
+ */
+bool NewickParser::readBranchLength(Node *p){
+    char buf[64];
+    size_t len = 0;
+    while(cur < last && len < sizeof(buf) - 1 &&
+          (isdigit((unsigned char) *cur) || *cur == '.' || *cur == '-' || *cur == '+' || *cur == 'e' || *cur == 'E'))
+        buf[len++] = *cur++;
+    buf[len] = '\0';
+    if(len == 0)
+        return fail("Missing branch length after colon");
+    char *numEnd;
+    double brlen = strtod(buf, &numEnd);
+    if(numEnd != buf + len)
+        return fail("Invalid branch length " + std::string(buf));
+    p->setBranchLength(brlen < 1.e-10 ? 1.e-10 : brlen);
+    return true;
+}
+
+/**
+ * @brief Reads a Newick tree from a range of characters
+ * @details Descends into a new left descendant at each left parenthesis, moves to the right descendant at a comma and
+ *          back up to the ancestor at a right parenthesis. Reading stops at the first semicolon or at the end of the range.
+ *
+ * @param begin first character of the tree
+ * @param end one past the last character of the tree
+ * @param rando random number generator handed to the SpeciesTree
+ * @return SpeciesTree* the tree read in, nullptr on an error (see getErrorMessage)
+ */
+SpeciesTree* NewickParser::parseSpeciesTree(const char *begin, const char *end, MbRandom *rando){
+    first = begin;
+    cur = begin;
+    last = end;
+    errorMsg.clear();
+    numTips = 0;
+    parsedNodes.clear();
+
+    Node *root = newNode();
+    root->setAsRoot(true);
+    Node *p = root;
+    Node *q;
+    bool atNodeStart = true;
+    std::string label;
+
+    skipSpaceAndComments();
+    while(true){
+        if(atNodeStart){
+            if(cur < last && *cur == '('){
+                ++cur;
+                q = newNode();
+                q->setAnc(p);
+                p->setLdes(q);
+                p = q;
+            }
+            else{
+                if(!readLabel(label))
+                    return nullptr;
+                if(translate != nullptr){
+                    auto tn = translate->find(label);
+                    if(tn != translate->end())
+                        label = tn->second;
+                }
+                p->setIsTip(true);
+                p->setName(label);
+                numTips++;
+                atNodeStart = false;
+            }
+            skipSpaceAndComments();
+            continue;
+        }
+
+        if(cur < last && *cur == ':'){
+            ++cur;
+            skipSpaceAndComments();
+            if(!readBranchLength(p))
+                return nullptr;
+            skipSpaceAndComments();
+        }
+        if(cur >= last || *cur == ';'){
+            if(p != root){
+                fail("Missing right parenthesis");
+                return nullptr;
+            }
+            break;
+        }
+        else if(*cur == ','){
+            q = p->getAnc();
+            if(q == nullptr){
+                fail("Comma outside of parentheses");
+                return nullptr;
+            }
+            if(q->getRdes() != nullptr){
+                fail("Node with more than two descendants, only binary trees can be read");
+                return nullptr;
+            }
+            ++cur;
+            Node *r = newNode();
+            r->setAnc(q);
+            q->setRdes(r);
+            r->setSib(p);
+            p->setSib(r);
+            p = r;
+            atNodeStart = true;
+        }
+        else if(*cur == ')'){
+            q = p->getAnc();
+            if(q == nullptr){
+                fail("Unexpected right parenthesis");
+                return nullptr;
+            }
+            if(q->getRdes() == nullptr){
+                fail("Node with a single descendant");
+                return nullptr;
+            }
+            ++cur;
+            p = q;
+            skipSpaceAndComments();
+            // internal node labels are not used
+            if(!readLabel(label))
+                return nullptr;
+        }
+        else{
+            fail(std::string("Unexpected character '") + *cur + "'");
+            return nullptr;
+        }
+        skipSpaceAndComments();
+    }
+    if(numTips < 2){
+        fail("Tree has fewer than two tips");
+        return nullptr;
+    }
+
+    auto *spTree = new SpeciesTree(rando, numTips);
+    Node *initRoot = spTree->getRoot();
+    spTree->setRoot(root);
+    spTree->popNodes();
+    delete initRoot;
+    spTree->setTreeInfo();
+    parsedNodes.clear();
+    return spTree;
+}
+
+/**
+ * @brief Reads a Newick tree from a string
+ *
+ * @param newick Newick string
+ * @param rando random number generator handed to the SpeciesTree
+ * @return SpeciesTree* the tree read in, nullptr on an error (see getErrorMessage)
+ */
+SpeciesTree* NewickParser::parseSpeciesTree(const std::string &newick, MbRandom *rando){
+    return parseSpeciesTree(newick.data(), newick.data() + newick.size(), rando);
+}
@@ -0,0 +1,42 @@
+#ifndef NewickParser_h
+#define NewickParser_h
+
+#include "SpeciesTree.h"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+typedef std::unordered_map<std::string, std::string> TranslateTable;
+
+/**
+ * @brief Single pass reader of binary Newick trees into the SpeciesTree class
+ * @details The string is read once from left to right without recursion, so trees with very many tips
+ *          can be read. Comments in square brackets are skipped, tip names may be quoted (with '' for a quote),
+ *          internal node labels are read and dropped, and branch lengths may use scientific notation.
+ *          Errors are not fatal: the parser returns nullptr and keeps a message saying what went wrong and where.
+ *          Tip names can be looked up in a NEXUS translate table.
+ */
+class NewickParser{
+    private:
+        const char          *first, *cur, *last;
+        std::string         errorMsg;
+        unsigned            numTips;
+        std::vector<Node*>  parsedNodes;
+        const TranslateTable *translate;
+
+        Node*               newNode();
+        bool                fail(const std::string &msg);
+        void                skipSpaceAndComments();
+        bool                readLabel(std::string &label);
+        bool                readBranchLength(Node *p);
+
+    public:
+                            NewickParser();
+        SpeciesTree*        parseSpeciesTree(const char *begin, const char *end, MbRandom *rando);
+        SpeciesTree*        parseSpeciesTree(const std::string &newick, MbRandom *rando);
+        void                setTranslateTable(const TranslateTable *tt) { translate = tt; }
+        std::string         getErrorMessage() { return errorMsg; }
+        unsigned            getNumTips() { return numTips; }
+};
+
+#endif /* NewickParser_h */
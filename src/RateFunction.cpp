@@ -0,0 +1,172 @@
+#include "RateFunction.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
+/**
+ * @brief Reads rate shifts "t1:r1,t2:r2,..."
+ *
+ * @param s shifts with increasing positive times and non-negative rates
+ * @param err set to what is wrong with s
+ * @return false if s is malformed
+ */
+bool RateChanges::parseShifts(const std::string &s, std::string &err){
+    shiftTimes.clear();
+    shiftRates.clear();
+    std::stringstream ss(s);
+    std::string item;
+    while(std::getline(ss, item, ',')){
+        size_t colon = item.find(':');
+        char *endT, *endR;
+        double t = strtod(item.c_str(), &endT);
+        double r = (colon == std::string::npos) ? 0.0 : strtod(item.c_str() + colon + 1, &endR);
+        if(colon == std::string::npos || endT != item.c_str() + colon || *endR != '\0'){
+            err = "rate shift " + item + " is not of the form time:rate";
+            return false;
+        }
+        if(t <= 0.0 || (!shiftTimes.empty() && t <= shiftTimes.back()) || r < 0.0){
+            err = "rate shift " + item + " needs a positive time after the previous shift and a non-negative rate";
+            return false;
+        }
+        shiftTimes.push_back(t);
+        shiftRates.push_back(r);
+    }
+    if(shiftTimes.empty()){
+        err = "no rate shifts in " + s;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Writes the changes in a form that differs whenever the changes do, for the settings of a checkpoint
+ */
+std::string RateChanges::toString() const{
+    std::stringstream ss;
+    ss << std::setprecision(17) << exponent;
+    for(size_t i = 0; i < shiftTimes.size(); i++)
+        ss << (i == 0 ? ";" : ",") << shiftTimes[i] << ":" << shiftRates[i];
+    return ss.str();
+}
+
+/**
+ * @brief Creates the rate function of a rate with its changes over time
+ *
+ * @param r0 rate at time 0
+ * @param rc changes of the rate
+ * @return RateFunction* owned by the caller, nullptr if the rate is constant
+ */
+RateFunction* RateFunction::create(double r0, const RateChanges &rc){
+    if(!rc.shiftTimes.empty())
+        return new PiecewiseConstantRate(r0, rc.shiftTimes, rc.shiftRates);
+    if(rc.exponent != 0.0)
+        return new ExponentialRate(r0, rc.exponent);
+    return nullptr;
+}
+
+/**
+ * @brief Constructor of the PiecewiseConstantRate class
+ *
+ * @param r0 rate from time 0 to the first shift
+ * @param shiftTimes increasing times of the shifts
+ * @param shiftRates rate from each shift to the next
+ */
+PiecewiseConstantRate::PiecewiseConstantRate(double r0, const std::vector<double> &shiftTimes,
+                                             const std::vector<double> &shiftRates){
+    startTimes.push_back(0.0);
+    rates.push_back(r0);
+    startTimes.insert(startTimes.end(), shiftTimes.begin(), shiftTimes.end());
+    rates.insert(rates.end(), shiftRates.begin(), shiftRates.end());
+}
+
+double PiecewiseConstantRate::getRate(double t) const{
+    size_t i = std::upper_bound(startTimes.begin(), startTimes.end(), t) - startTimes.begin();
+    return rates[i > 0 ? i - 1 : 0];
+}
+
+/**
+ * @brief Time at which the integral of the rate from t0 reaches x
+ * @details Walks the pieces from the one holding t0, taking the integral of each piece whole until the one it ends in
+ *
+ * @param t0 time to integrate from
+ * @param x value the integral has to reach
+ * @return the time, infinity if the rate is 0 from some time on and the integral never reaches x
+ */
+double PiecewiseConstantRate::getEventTime(double t0, double x) const{
+    size_t i = std::upper_bound(startTimes.begin(), startTimes.end(), t0) - startTimes.begin();
+    i = (i > 0) ? i - 1 : 0;
+    double t = t0;
+    for(; i + 1 < startTimes.size(); i++){
+        double piece = rates[i] * (startTimes[i + 1] - t);
+        if(x < piece)
+            return t + x / rates[i];
+        x -= piece;
+        t = startTimes[i + 1];
+    }
+    if(rates[i] <= 0.0)
+        return std::numeric_limits<double>::infinity();
+    return t + x / rates[i];
+}
+
+/**
+ * @brief Smallest rate of any piece
+ */
+double PiecewiseConstantRate::getMinRate() const{
+    return *std::min_element(rates.begin(), rates.end());
+}
+
+/**
+ * @brief Largest rate of any piece
+ */
+double PiecewiseConstantRate::getMaxRate() const{
+    return *std::max_element(rates.begin(), rates.end());
+}
+
+/**
+ * @brief Constructor of the ExponentialRate class
+ *
+ * @param r0 rate at time 0
+ * @param a exponent of the change of the rate per unit of time
+ */
+ExponentialRate::ExponentialRate(double r0, double a){
+    rate0 = r0;
+    exponent = a;
+}
+
+double ExponentialRate::getRate(double t) const{
+    return rate0 * std::exp(exponent * t);
+}
+
+/**
+ * @brief Time at which the integral of the rate from t0 reaches x
+ * @details Solves r0 / a * (exp(a * t) - exp(a * t0)) = x for t
+ *
+ * @param t0 time to integrate from
+ * @param x value the integral has to reach
+ * @return the time, infinity if a decaying rate never adds up to x
+ */
+double ExponentialRate::getEventTime(double t0, double x) const{
+    if(rate0 <= 0.0)
+        return std::numeric_limits<double>::infinity();
+    double y = std::exp(exponent * t0) + exponent * x / rate0;
+    if(y <= 0.0)
+        return std::numeric_limits<double>::infinity();
+    return std::log(y) / exponent;
+}
+
+/**
+ * @brief Smallest rate from time 0 on, a decaying rate goes down to 0
+ */
+double ExponentialRate::getMinRate() const{
+    return exponent < 0.0 ? 0.0 : rate0;
+}
+
+/**
+ * @brief Largest rate from time 0 on, a growing rate has no bound
+ */
+double ExponentialRate::getMaxRate() const{
+    return exponent > 0.0 ? std::numeric_limits<double>::infinity() : rate0;
+}
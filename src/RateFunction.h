@@ -0,0 +1,72 @@
+#ifndef RateFunction_h
+#define RateFunction_h
+
+#include <string>
+#include <vector>
+
+/**
+ * @brief Changes over time of a species birth or death rate, as set on the command line
+ * @details Either shifts of a piecewise constant rate, given as "t1:r1,t2:r2,..." with the rate r1 from time t1 on and so
+ *          on, or the exponent a of a rate r0 * exp(a * t). Times run forward from the origin of the tree, before any
+ *          scaling with -sc.
+ */
+struct RateChanges{
+    std::vector<double>     shiftTimes;
+    std::vector<double>     shiftRates;
+    double                  exponent = 0.0;
+
+    bool                    isConstant() const { return shiftTimes.empty() && exponent == 0.0; }
+    bool                    parseShifts(const std::string &s, std::string &err);
+    std::string             toString() const;
+};
+
+/**
+ * @brief Rate of a Poisson process that changes with time
+ * @details Event times are drawn by inverting the integral of the rate in closed form, so a time varying rate costs one
+ *          standard exponential and one inversion per event, as a constant rate does. The functions hold no state and
+ *          can be shared by threads.
+ */
+class RateFunction{
+    public:
+        virtual                 ~RateFunction() = default;
+        virtual double          getRate(double t) const = 0;
+        virtual double          getEventTime(double t0, double x) const = 0;
+        virtual double          getMinRate() const = 0;
+        virtual double          getMaxRate() const = 0;
+        static RateFunction*    create(double r0, const RateChanges &rc);
+};
+
+/**
+ * @brief Rate that is constant between shift times
+ */
+class PiecewiseConstantRate : public RateFunction{
+    private:
+        std::vector<double>     startTimes;
+        std::vector<double>     rates;
+
+    public:
+                                PiecewiseConstantRate(double r0, const std::vector<double> &shiftTimes,
+                                                      const std::vector<double> &shiftRates);
+        double                  getRate(double t) const;
+        double                  getEventTime(double t0, double x) const;
+        double                  getMinRate() const;
+        double                  getMaxRate() const;
+};
+
+/**
+ * @brief Rate r0 * exp(a * t), growing for a > 0 and decaying for a < 0
+ */
+class ExponentialRate : public RateFunction{
+    private:
+        double                  rate0;
+        double                  exponent;
+
+    public:
+                                ExponentialRate(double r0, double a);
+        double                  getRate(double t) const;
+        double                  getEventTime(double t0, double x) const;
+        double                  getMinRate() const;
+        double                  getMaxRate() const;
+};
+
+#endif /* RateFunction_h */
@@ -0,0 +1,260 @@
+#include "RunSummary.h"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+/**
+ * @brief Constructor of the RunningStat class
+ *
+ * @param k number of values kept per level of the quantile sketch, quantiles are exact up to k values
+ */
+RunningStat::RunningStat(unsigned k){
+    count = 0;
+    mean = 0.0;
+    m2 = 0.0;
+    minVal = 0.0;
+    maxVal = 0.0;
+    sketchSize = (k < 2) ? 2 : k;
+    compactOdd = false;
+    compactors.resize(1);
+}
+
+/**
+ * @brief Adds one value to the running mean, variance, and quantile sketch
+ *
+ * @param x value to add
+ */
+void RunningStat::addValue(double x){
+    count++;
+    double delta = x - mean;
+    mean += delta / count;
+    m2 += delta * (x - mean);
+    if(count == 1 || x < minVal)
+        minVal = x;
+    if(count == 1 || x > maxVal)
+        maxVal = x;
+
+    compactors[0].push_back(x);
+    if(compactors[0].size() >= sketchSize)
+        compact(0);
+}
+
+/**
+ * @brief Halves a full level of the sketch by promoting every other sorted value to the level above
+ * @details The offset alternates between calls so that the errors of successive compactions cancel out.
+ *          With an odd number of values the largest stays behind, so the total weight is unchanged.
+ *
+ * @param level level of the sketch to compact
+ */
+void RunningStat::compact(unsigned level){
+    while(level < compactors.size() && compactors[level].size() >= sketchSize){
+        if(level + 1 == compactors.size())
+            compactors.emplace_back();
+        std::vector<double> &cur = compactors[level];
+        std::sort(cur.begin(), cur.end());
+        size_t n = cur.size() - (cur.size() % 2);
+        for(size_t i = compactOdd ? 1 : 0; i < n; i += 2)
+            compactors[level + 1].push_back(cur[i]);
+        compactOdd = !compactOdd;
+        cur.erase(cur.begin(), cur.begin() + n);
+        level++;
+    }
+}
+
+/**
+ * @brief Merges the summary of another set of values into this one
+ * @details Means and variances are combined with the pairwise formula of Chan et al.,
+ *          sketch levels are appended to each other and compacted where they overflow
+ *
+ * @param rs RunningStat to merge in
+ */
+void RunningStat::merge(const RunningStat &rs){
+    if(rs.count == 0)
+        return;
+    if(count == 0){
+        *this = rs;
+        return;
+    }
+    unsigned long n = count + rs.count;
+    double delta = rs.mean - mean;
+    mean += delta * rs.count / n;
+    m2 += rs.m2 + delta * delta * ((double) count * rs.count / n);
+    count = n;
+    minVal = std::min(minVal, rs.minVal);
+    maxVal = std::max(maxVal, rs.maxVal);
+
+    if(compactors.size() < rs.compactors.size())
+        compactors.resize(rs.compactors.size());
+    for(unsigned i = 0; i < rs.compactors.size(); i++)
+        compactors[i].insert(compactors[i].end(), rs.compactors[i].begin(), rs.compactors[i].end());
+    for(unsigned i = 0; i < compactors.size(); i++)
+        compact(i);
+}
+
+/**
+ * @brief Sample variance of the values
+ * @return double variance, 0 with fewer than two values
+ */
+double RunningStat::getVariance() const{
+    return (count > 1) ? m2 / (count - 1) : 0.0;
+}
+
+/**
+ * @brief Approximate quantile of the values from the sketch, values on level i carry a weight of 2^i
+ *
+ * @param q probability between 0 and 1
+ * @return double quantile of the values
+ */
+double RunningStat::getQuantile(double q) const{
+    if(count == 0)
+        return 0.0;
+    if(q <= 0.0)
+        return minVal;
+    if(q >= 1.0)
+        return maxVal;
+    std::vector<std::pair<double, double> > weighted;
+    double totalWeight = 0.0;
+    double w = 1.0;
+    for(const auto & level : compactors){
+        for(auto v : level)
+            weighted.emplace_back(v, w);
+        totalWeight += w * level.size();
+        w *= 2.0;
+    }
+    std::sort(weighted.begin(), weighted.end());
+    double target = q * totalWeight;
+    double cumWeight = 0.0;
+    for(const auto & vw : weighted){
+        cumWeight += vw.second;
+        if(cumWeight >= target)
+            return vw.first;
+    }
+    return maxVal;
+}
+
+/**
+ * @brief Writes the exact state of the statistic, including its sketch, so a run can be continued from it
+ * @details Doubles are written with 17 significant digits so they are read back unchanged
+ *
+ * @param out stream to write to
+ */
+void RunningStat::writeState(std::ostream &out) const{
+    std::streamsize prec = out.precision(17);
+    out << count << " " << mean << " " << m2 << " " << minVal << " " << maxVal << " ";
+    out << sketchSize << " " << compactOdd << " " << compactors.size() << "\n";
+    for(const auto & level : compactors){
+        out << level.size();
+        for(auto v : level)
+            out << " " << v;
+        out << "\n";
+    }
+    out.precision(prec);
+}
+
+/**
+ * @brief Restores a state written by writeState
+ *
+ * @param in stream to read from
+ * @return false if the state could not be read
+ */
+bool RunningStat::readState(std::istream &in){
+    size_t numLevels, levelSize;
+    if(!(in >> count >> mean >> m2 >> minVal >> maxVal >> sketchSize >> compactOdd >> numLevels) || numLevels == 0)
+        return false;
+    compactors.assign(numLevels, std::vector<double>());
+    for(auto & level : compactors){
+        if(!(in >> levelSize))
+            return false;
+        level.resize(levelSize);
+        for(auto & v : level){
+            if(!(in >> v))
+                return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Finds a statistic by name, adding it to the end of the summary if it is new
+ *
+ * @param name name of the statistic
+ * @return RunningStat& of the statistic
+ */
+RunningStat& RunSummary::findStat(const std::string &name){
+    for(unsigned i = 0; i < names.size(); i++){
+        if(names[i] == name)
+            return stats[i];
+    }
+    names.push_back(name);
+    stats.emplace_back();
+    return stats.back();
+}
+
+/**
+ * @brief Adds one value of a statistic, NaN and infinite values are skipped
+ *
+ * @param name name of the statistic
+ * @param x value to add
+ */
+void RunSummary::addValue(const std::string &name, double x){
+    if(std::isfinite(x))
+        findStat(name).addValue(x);
+}
+
+/**
+ * @brief Merges the statistics of another RunSummary (e.g. from a different worker) into this one
+ *
+ * @param rs RunSummary to merge in
+ */
+void RunSummary::merge(const RunSummary &rs){
+    for(unsigned i = 0; i < rs.names.size(); i++)
+        findStat(rs.names[i]).merge(rs.stats[i]);
+}
+
+/**
+ * @brief Writes the summary as a tab delimited table with one statistic per line
+ *
+ * @param out stream to write to
+ */
+void RunSummary::printSummary(std::ostream &out) const{
+    out << "Statistic\tN\tMean\tSD\tMin\t2.5%\tMedian\t97.5%\tMax" << std::endl;
+    for(unsigned i = 0; i < names.size(); i++){
+        const RunningStat &rs = stats[i];
+        out << names[i] << "\t" << rs.getCount() << "\t" << rs.getMean() << "\t" << std::sqrt(rs.getVariance());
+        out << "\t" << rs.getMin() << "\t" << rs.getQuantile(0.025) << "\t" << rs.getQuantile(0.5);
+        out << "\t" << rs.getQuantile(0.975) << "\t" << rs.getMax() << std::endl;
+    }
+}
+
+/**
+ * @brief Writes the state of every statistic, each preceded by its name on a line of its own
+ *
+ * @param out stream to write to
+ */
+void RunSummary::writeState(std::ostream &out) const{
+    out << names.size() << "\n";
+    for(unsigned i = 0; i < names.size(); i++){
+        out << names[i] << "\n";
+        stats[i].writeState(out);
+    }
+}
+
+/**
+ * @brief Replaces the statistics with a state written by writeState
+ *
+ * @param in stream to read from
+ * @return false if the state could not be read
+ */
+bool RunSummary::readState(std::istream &in){
+    size_t n;
+    if(!(in >> n))
+        return false;
+    names.assign(n, std::string());
+    stats.assign(n, RunningStat());
+    for(unsigned i = 0; i < n; i++){
+        in >> std::ws;
+        if(!getline(in, names[i]) || !stats[i].readState(in))
+            return false;
+    }
+    return true;
+}
@@ -0,0 +1,61 @@
+#ifndef RunSummary_h
+#define RunSummary_h
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Streaming summary of one statistic across replicates
+ * @details Mean and variance are updated with Welford's algorithm. Quantiles come from a small mergeable sketch
+ *          of compactors: each level holds at most sketchSize values, and a full level is sorted and every other
+ *          value is promoted to the next level with twice the weight. Memory grows with the log of the number of
+ *          values only, and two summaries (e.g. from different workers) can be merged without the raw values.
+ */
+class RunningStat{
+    private:
+        unsigned long                       count;
+        double                              mean, m2;
+        double                              minVal, maxVal;
+        unsigned                            sketchSize;
+        bool                                compactOdd;
+        std::vector<std::vector<double> >   compactors;
+
+        void                                compact(unsigned level);
+
+    public:
+                                            RunningStat(unsigned k = 128);
+        void                                addValue(double x);
+        void                                merge(const RunningStat &rs);
+        unsigned long                       getCount() const { return count; }
+        double                              getMean() const { return mean; }
+        double                              getVariance() const;
+        double                              getMin() const { return minVal; }
+        double                              getMax() const { return maxVal; }
+        double                              getQuantile(double q) const;
+        void                                writeState(std::ostream &out) const;
+        bool                                readState(std::istream &in);
+};
+
+/**
+ * @brief Named collection of RunningStat used to summarise a whole simulation run
+ * @details Statistics are kept in the order they are first added so the summary table follows the order
+ *          of the stats files
+ */
+class RunSummary{
+    private:
+        std::vector<std::string>            names;
+        std::vector<RunningStat>            stats;
+
+        RunningStat&                        findStat(const std::string &name);
+
+    public:
+        void                                addValue(const std::string &name, double x);
+        void                                merge(const RunSummary &rs);
+        bool                                empty() const { return names.empty(); }
+        void                                printSummary(std::ostream &out) const;
+        void                                writeState(std::ostream &out) const;
+        bool                                readState(std::istream &in);
+};
+
+#endif /* RunSummary_h */
@@ -0,0 +1,190 @@
+#include "SimProfile.h"
+#include <algorithm>
+
+namespace {
+    const char *phaseNames[SimProfile::NumPhases] = {"gsa", "reconstruction", "locus_sim", "coalescent", "printing", "file_write"};
+    const char *eventNames[SimProfile::NumEvents] = {"species_birth", "species_death", "gene_birth", "gene_death", "transfer", "speciation", "coalescence"};
+}
+
+/**
+ * @brief Starts timing a phase, pausing the timer already running on the same profile
+ *
+ * @param p profile to add the time to, nullptr to time nothing
+ * @param ph phase the time is spent in
+ */
+SimProfile::Timer::Timer(SimProfile *p, Phase ph){
+    profile = p;
+    phase = ph;
+    outer = nullptr;
+    if(profile == nullptr)
+        return;
+    start = std::chrono::steady_clock::now();
+    outer = profile->activeTimer;
+    if(outer != nullptr)
+        profile->phaseTimes[outer->phase] += std::chrono::duration<double>(start - outer->start).count();
+    profile->activeTimer = this;
+}
+
+/**
+ * @brief Adds the time since the timer started to its phase and resumes the timer it paused
+ */
+SimProfile::Timer::~Timer(){
+    if(profile == nullptr)
+        return;
+    std::chrono::steady_clock::time_point stop = std::chrono::steady_clock::now();
+    profile->phaseTimes[phase] += std::chrono::duration<double>(stop - start).count();
+    profile->activeTimer = outer;
+    if(outer != nullptr)
+        outer->start = stop;
+}
+
+/**
+ * @brief Constructor of the SimProfile class
+ *
+ * @param rep index of the replicate profiled, -1 for the total of a run
+ */
+SimProfile::SimProfile(int rep){
+    replicate = rep;
+    std::fill(phaseTimes, phaseTimes + NumPhases, 0.0);
+    std::fill(eventCounts, eventCounts + NumEvents, 0UL);
+    gsaRestarts = 0;
+    peakNodes = 0;
+    activeTimer = nullptr;
+}
+
+/**
+ * @brief Adds the times and counts of another profile to this one, the peak node count is the larger of the two
+ *
+ * @param sp profile to add
+ */
+void SimProfile::merge(const SimProfile &sp){
+    for(int i = 0; i < NumPhases; i++)
+        phaseTimes[i] += sp.phaseTimes[i];
+    for(int i = 0; i < NumEvents; i++)
+        eventCounts[i] += sp.eventCounts[i];
+    gsaRestarts += sp.gsaRestarts;
+    updatePeakNodes(sp.peakNodes);
+}
+
+/**
+ * @brief Writes the profile as a JSON object
+ * @details Times are wall times in seconds, peak_nodes is the largest number of nodes held by one tree
+ *
+ * @param out stream to write to
+ */
+void SimProfile::writeJson(std::ostream &out) const{
+    out << "{";
+    if(replicate >= 0)
+        out << "\"replicate\": " << replicate << ", ";
+    out << "\"seconds\": {";
+    for(int i = 0; i < NumPhases; i++)
+        out << (i > 0 ? ", " : "") << "\"" << phaseNames[i] << "\": " << phaseTimes[i];
+    out << "}, \"events\": {";
+    for(int i = 0; i < NumEvents; i++)
+        out << (i > 0 ? ", " : "") << "\"" << eventNames[i] << "\": " << eventCounts[i];
+    out << "}, \"gsa_restarts\": " << gsaRestarts << ", \"peak_nodes\": " << peakNodes << "}";
+}
+
+/**
+ * @brief Writes the times and counts of the profile so a checkpointed run can restore them
+ *
+ * @param out stream to write to
+ */
+void SimProfile::writeState(std::ostream &out) const{
+    std::streamsize prec = out.precision(17);
+    out << replicate;
+    for(int i = 0; i < NumPhases; i++)
+        out << " " << phaseTimes[i];
+    for(int i = 0; i < NumEvents; i++)
+        out << " " << eventCounts[i];
+    out << " " << gsaRestarts << " " << peakNodes << "\n";
+    out.precision(prec);
+}
+
+/**
+ * @brief Restores a state written by writeState
+ *
+ * @param in stream to read from
+ * @return false if the state could not be read
+ */
+bool SimProfile::readState(std::istream &in){
+    if(!(in >> replicate))
+        return false;
+    for(int i = 0; i < NumPhases; i++){
+        if(!(in >> phaseTimes[i]))
+            return false;
+    }
+    for(int i = 0; i < NumEvents; i++){
+        if(!(in >> eventCounts[i]))
+            return false;
+    }
+    return (bool) (in >> gsaRestarts >> peakNodes);
+}
+
+/**
+ * @brief Adds the profile of a finished replicate to the run
+ *
+ * @param sp profile of the replicate
+ */
+void RunProfile::addReplicate(const SimProfile &sp){
+    total.merge(sp);
+    replicates.push_back(sp);
+}
+
+/**
+ * @brief Adds the replicates of another RunProfile, e.g. one kept by another worker
+ *
+ * @param rp profile to add
+ */
+void RunProfile::merge(const RunProfile &rp){
+    total.merge(rp.total);
+    replicates.insert(replicates.end(), rp.replicates.begin(), rp.replicates.end());
+}
+
+/**
+ * @brief Writes the total of the run and the profile of each replicate, in order of replicate, as a JSON object
+ *
+ * @param out stream to write to
+ */
+void RunProfile::writeJson(std::ostream &out){
+    std::stable_sort(replicates.begin(), replicates.end(),
+                     [](const SimProfile &a, const SimProfile &b){ return a.getReplicate() < b.getReplicate(); });
+    out << "{\n\"run\": ";
+    total.writeJson(out);
+    out << ",\n\"replicates\": [";
+    for(size_t i = 0; i < replicates.size(); i++){
+        out << (i > 0 ? ",\n" : "\n");
+        replicates[i].writeJson(out);
+    }
+    out << "\n]\n}" << std::endl;
+}
+
+/**
+ * @brief Writes the total and the replicate profiles of the run so a checkpointed run can restore them
+ *
+ * @param out stream to write to
+ */
+void RunProfile::writeState(std::ostream &out) const{
+    out << replicates.size() << "\n";
+    total.writeState(out);
+    for(const auto & sp : replicates)
+        sp.writeState(out);
+}
+
+/**
+ * @brief Replaces the profiles with a state written by writeState
+ *
+ * @param in stream to read from
+ * @return false if the state could not be read
+ */
+bool RunProfile::readState(std::istream &in){
+    size_t n;
+    if(!(in >> n) || !total.readState(in))
+        return false;
+    replicates.assign(n, SimProfile());
+    for(auto & sp : replicates){
+        if(!sp.readState(in))
+            return false;
+    }
+    return true;
+}
@@ -0,0 +1,78 @@
+#ifndef SimProfile_h
+#define SimProfile_h
+
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+/**
+ * @brief Wall time spent in each phase of a simulation and counts of the events simulated
+ * @details Filled in by the Simulator and the Engine for one replicate when profiling is turned on. Times are
+ *          exclusive: a Timer started while another one is running pauses the outer one, so the time of the
+ *          reconstructions done during the GSA is not counted in the GSA as well.
+ */
+class SimProfile{
+    public:
+        enum Phase { Phase_GSA, Phase_Reconstruction, Phase_LocusSim, Phase_Coalescent, Phase_Printing, Phase_FileWrite, NumPhases };
+        enum Event { Event_SpeciesBirth, Event_SpeciesDeath, Event_GeneBirth, Event_GeneDeath, Event_Transfer, Event_Speciation, Event_Coalescence, NumEvents };
+
+        /**
+         * @brief Adds the wall time from its construction to its destruction to one phase of a SimProfile
+         * @details Does nothing when the profile is nullptr, so the Simulator can keep timers in place with profiling off
+         */
+        class Timer{
+            private:
+                SimProfile                              *profile;
+                Phase                                   phase;
+                Timer                                   *outer;
+                std::chrono::steady_clock::time_point   start;
+
+            public:
+                                                        Timer(SimProfile *p, Phase ph);
+                                                        ~Timer();
+                                                        Timer(const Timer&) = delete;
+                Timer&                                  operator=(const Timer&) = delete;
+        };
+
+    private:
+        int                                 replicate;
+        double                              phaseTimes[NumPhases];
+        unsigned long                       eventCounts[NumEvents];
+        unsigned long                       gsaRestarts;
+        unsigned long                       peakNodes;
+        Timer                               *activeTimer;
+
+    public:
+                                            SimProfile(int rep = -1);
+        void                                setReplicate(int rep) { replicate = rep; }
+        int                                 getReplicate() const { return replicate; }
+        void                                countEvent(Event e, unsigned long n = 1) { eventCounts[e] += n; }
+        void                                addGSARestarts(unsigned long n) { gsaRestarts += n; }
+        void                                updatePeakNodes(unsigned long n) { if(n > peakNodes) peakNodes = n; }
+        double                              getPhaseTime(Phase p) const { return phaseTimes[p]; }
+        unsigned long                       getEventCount(Event e) const { return eventCounts[e]; }
+        void                                merge(const SimProfile &sp);
+        void                                writeJson(std::ostream &out) const;
+        void                                writeState(std::ostream &out) const;
+        bool                                readState(std::istream &in);
+};
+
+/**
+ * @brief Profiles of the replicates of a run and their total
+ * @details Kept next to the RunSummary of a run and merged the same way when replicates are run by several workers
+ */
+class RunProfile{
+    private:
+        SimProfile                          total;
+        std::vector<SimProfile>             replicates;
+
+    public:
+        void                                addReplicate(const SimProfile &sp);
+        void                                merge(const RunProfile &rp);
+        bool                                empty() const { return replicates.empty(); }
+        void                                writeJson(std::ostream &out);
+        void                                writeState(std::ostream &out) const;
+        bool                                readState(std::istream &in);
+};
+
+#endif /* SimProfile_h */
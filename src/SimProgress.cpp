@@ -0,0 +1,86 @@
+#include "SimProgress.h"
+#include <cstdio>
+#include <unistd.h>
+
+/**
+ * @brief Constructor of the SimProgress class
+ *
+ * @param total number of replicates of the run, 0 if it is not known in advance
+ * @param done number of replicates already done when the run starts, as when it is resumed from a checkpoint
+ * @param ms milliseconds between two reports
+ */
+SimProgress::SimProgress(unsigned long total, unsigned long done, unsigned ms) : replicatesDone(done), eventsDone(0){
+    totalReplicates = total;
+    firstReplicate = done;
+    interval = std::chrono::milliseconds(ms);
+    // on a terminal each report replaces the last, redirected to a file each one gets its own line
+    overwriteLine = isatty(STDERR_FILENO) != 0;
+    stopping = false;
+}
+
+SimProgress::~SimProgress(){
+    finish();
+}
+
+/**
+ * @brief Starts the thread printing the reports
+ */
+void SimProgress::start(){
+    startTime = std::chrono::steady_clock::now();
+    reporter = std::thread(&SimProgress::runReporter, this);
+}
+
+/**
+ * @brief Stops the thread printing the reports and prints the final one
+ */
+void SimProgress::finish(){
+    if(!reporter.joinable())
+        return;
+    {
+        std::lock_guard<std::mutex> lock(stopMutex);
+        stopping = true;
+    }
+    stopCond.notify_all();
+    reporter.join();
+    report(true);
+}
+
+/**
+ * @brief Loop of the reporting thread, prints a report every interval until the run finishes
+ */
+void SimProgress::runReporter(){
+    std::unique_lock<std::mutex> lock(stopMutex);
+    while(!stopCond.wait_for(lock, interval, [this](){ return stopping; }))
+        report(false);
+}
+
+/**
+ * @brief Prints one report, with rates averaged over the whole run so far
+ *
+ * @param last true for the report printed once the run is done
+ */
+void SimProgress::report(bool last){
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    unsigned long reps = replicatesDone.load(std::memory_order_relaxed);
+    unsigned long events = eventsDone.load(std::memory_order_relaxed);
+    double repRate = (elapsed > 0.0) ? (double) (reps - firstReplicate) / elapsed : 0.0;
+    double eventRate = (elapsed > 0.0) ? (double) events / elapsed : 0.0;
+
+    char line[160];
+    int n;
+    if(totalReplicates > 0)
+        n = snprintf(line, sizeof(line), "Replicate %lu of %lu, %.3g replicates/s, %.3g events/s",
+                     reps, totalReplicates, repRate, eventRate);
+    else
+        n = snprintf(line, sizeof(line), "Replicate %lu, %.3g replicates/s, %.3g events/s", reps, repRate, eventRate);
+    if(n > 0 && (size_t) n < sizeof(line)){
+        if(last)
+            n += snprintf(line + n, sizeof(line) - n, ", %.1f s in total", elapsed);
+        else if(totalReplicates > reps && repRate > 0.0){
+            auto left = (unsigned long) ((double) (totalReplicates - reps) / repRate + 0.5);
+            n += snprintf(line + n, sizeof(line) - n, ", %lu:%02lu:%02lu left", left / 3600, (left / 60) % 60, left % 60);
+        }
+    }
+    fprintf(stderr, overwriteLine ? "\r%s\033[K%s" : "%s%s", line, (last || !overwriteLine) ? "\n" : "");
+    fflush(stderr);
+}
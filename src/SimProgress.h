@@ -0,0 +1,44 @@
+#ifndef SimProgress_h
+#define SimProgress_h
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+/**
+ * @brief Reports the progress of a run on standard error at a fixed interval
+ * @details Workers only add to atomic counters, a thread of its own wakes up every interval and prints the number of
+ *          replicates done, replicates and events per second, and the estimated time left. Nothing is printed by the
+ *          threads doing the simulating, so turning the report on does not slow them down.
+ */
+class SimProgress{
+    private:
+        std::atomic<unsigned long>              replicatesDone;
+        std::atomic<unsigned long>              eventsDone;
+        unsigned long                           totalReplicates;
+        unsigned long                           firstReplicate;
+        std::chrono::milliseconds               interval;
+        std::chrono::steady_clock::time_point   startTime;
+        bool                                    overwriteLine;
+        bool                                    stopping;
+        std::mutex                              stopMutex;
+        std::condition_variable                 stopCond;
+        std::thread                             reporter;
+
+        void                                    report(bool last);
+        void                                    runReporter();
+
+    public:
+                                                SimProgress(unsigned long total, unsigned long done = 0, unsigned ms = 1000);
+                                                ~SimProgress();
+                                                SimProgress(const SimProgress&) = delete;
+        SimProgress&                            operator=(const SimProgress&) = delete;
+        void                                    start();
+        void                                    finish();
+        void                                    addReplicate() { replicatesDone.fetch_add(1, std::memory_order_relaxed); }
+        void                                    addEvents(unsigned long n) { eventsDone.fetch_add(n, std::memory_order_relaxed); }
+};
+
+#endif /* SimProgress_h */
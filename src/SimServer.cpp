@@ -0,0 +1,367 @@
+#include "SimServer.h"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/**
+ * @brief Client connection, closed once the reader and every job from it are done with it
+ */
+struct SimServer::Connection{
+    int                                 fd;
+    std::mutex                          writeMutex;
+    bool                                broken;
+
+    explicit Connection(int f) : fd(f), broken(false) {}
+    ~Connection() { close(fd); }
+
+    /**
+     * @brief Sends a block of lines without interleaving it with blocks sent by other workers
+     * @return false if the client is gone
+     */
+    bool send(const std::string &s){
+        std::lock_guard<std::mutex> lock(writeMutex);
+        size_t sent = 0;
+        while(!broken && sent < s.size()){
+            ssize_t n = ::send(fd, s.data() + sent, s.size() - sent, MSG_NOSIGNAL);
+            if(n < 0 && errno == EINTR)
+                continue;
+            if(n <= 0)
+                broken = true;
+            else
+                sent += (size_t) n;
+        }
+        return !broken;
+    }
+};
+
+/**
+ * @brief Constructor of the SimServer class
+ *
+ * @param path path of the Unix domain socket to listen on
+ * @param nw number of worker threads
+ * @param sd1 first seed of the generator the seeds of jobs are drawn from, 0 to seed from the time
+ * @param sd2 second seed of the generator the seeds of jobs are drawn from
+ */
+SimServer::SimServer(const std::string &path, unsigned nw, seedType sd1, seedType sd2){
+    socketPath = path;
+    numWorkers = (nw > 0) ? nw : 1;
+    if(sd1 > 0 && sd2 > 0)
+        rando.setSeed(sd1, sd2);
+    else if(sd1 > 0)
+        rando.setSeed(sd1, 0);
+    else
+        rando.setSeed();
+    listenFd = -1;
+    stopping = false;
+    activeReaders = 0;
+}
+
+/**
+ * @brief Reads the settings of a job from one line of flags
+ *
+ * @param line flags and values of the job
+ * @param job filled with the settings of the job
+ * @param err set to what is wrong with the line
+ * @return false if a flag is unknown or has no valid value
+ */
+bool SimServer::parseJob(const std::string &line, Job &job, std::string &err){
+    std::stringstream ss(line);
+    std::string flag, val;
+    SimSettings &s = job.settings;
+    while(ss >> flag){
+        if(!(ss >> val)){
+            err = "missing value for " + flag;
+            return false;
+        }
+        if(flag == "-id")
+            job.id = val;
+        else if(flag == "-o")
+            job.outFile = val;
+        else if(flag == "-istnw")
+            s.speciesTree = val;
+        else{
+            char *end;
+            double x = strtod(val.c_str(), &end);
+            if(*end != '\0'){
+                err = "invalid value " + val + " for " + flag;
+                return false;
+            }
+            if(flag == "-nt")
+                s.numTaxa = (int) x;
+            else if(flag == "-sbr")
+                s.spBirthRate = x;
+            else if(flag == "-sdr")
+                s.spDeathRate = x;
+            else if(flag == "-gbr")
+                s.geneBirthRate = x;
+            else if(flag == "-gdr")
+                s.geneDeathRate = x;
+            else if(flag == "-lgtr")
+                s.transferRate = x;
+            else if(flag == "-nl")
+                s.numLoci = (int) x;
+            else if(flag == "-ng")
+                s.numGenes = (int) x;
+            else if(flag == "-ipp")
+                s.indPerPop = (int) x;
+            else if(flag == "-ne")
+                s.popSize = (int) x;
+            else if(flag == "-og")
+                s.outgroupFrac = x;
+            else if(flag == "-sc")
+                s.treeScale = x;
+            else if(flag == "-rec")
+                s.sampleReconstructed = x != 0.0;
+            else if(flag == "-rho")
+                s.samplingFraction = x;
+            else if(flag == "-dtwf")
+                s.dtwfSwitch = (x > 0.0) ? (unsigned) x : 0;
+            else if(flag == "-r")
+                job.numReps = (int) x;
+            else if(flag == "-sd1")
+                job.sd1 = (seedType) x;
+            else if(flag == "-sd2")
+                job.sd2 = (seedType) x;
+            else{
+                err = "unknown flag " + flag;
+                return false;
+            }
+        }
+    }
+    // as on the command line, a negative gene birth rate turns off locus and gene trees
+    if(s.geneBirthRate < 0.0){
+        s.numLoci = 0;
+        s.geneBirthRate = 0.0;
+    }
+    if(job.numReps < 1){
+        err = "the number of replicates must be positive";
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Reads the jobs sent on a connection until the client shuts down its side, runs on its own thread
+ *
+ * @param conn connection to read from
+ */
+void SimServer::readJobs(std::shared_ptr<Connection> conn){
+    char buf[4096];
+    std::string pending, line;
+    int jobNum = 0;
+    bool eof = false;
+    while(!eof){
+        ssize_t n = recv(conn->fd, buf, sizeof(buf), 0);
+        if(n < 0 && errno == EINTR)
+            continue;
+        if(n <= 0){
+            eof = true;
+            if(pending.empty())
+                break;
+            pending += '\n';
+        }
+        else
+            pending.append(buf, (size_t) n);
+        size_t pos;
+        while((pos = pending.find('\n')) != std::string::npos){
+            line = pending.substr(0, pos);
+            pending.erase(0, pos + 1);
+            if(!line.empty() && line.back() == '\r')
+                line.pop_back();
+            size_t first = line.find_first_not_of(" \t");
+            if(first == std::string::npos || line[first] == '#')
+                continue;
+            if(line.compare(first, std::string::npos, "shutdown") == 0){
+                conn->send("shutdown\n");
+                this->stop();
+                continue;
+            }
+            Job job;
+            job.conn = conn;
+            job.id = std::to_string(++jobNum);
+            std::string err;
+            if(!this->parseJob(line, job, err)){
+                conn->send(job.id + "\terror\t" + err + "\n");
+                continue;
+            }
+            std::lock_guard<std::mutex> lock(queueMutex);
+            if(stopping){
+                conn->send(job.id + "\terror\tthe server is shutting down\n");
+                continue;
+            }
+            if(job.sd1 == 0){
+                job.sd1 = 1 + (seedType) (rando.uniformRv() * 2147483646.0);
+                job.sd2 = 1 + (seedType) (rando.uniformRv() * 2147483646.0);
+            }
+            jobs.push_back(std::move(job));
+            queueCond.notify_one();
+        }
+    }
+    conn.reset();
+    std::lock_guard<std::mutex> lock(queueMutex);
+    activeReaders--;
+    queueCond.notify_all();
+}
+
+/**
+ * @brief Loop of a worker thread, runs queued jobs until the server stops and the queue is empty
+ */
+void SimServer::runJobs(){
+    while(true){
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            queueCond.wait(lock, [this](){ return stopping || !jobs.empty(); });
+            if(jobs.empty())
+                return;
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+        this->runJob(job);
+    }
+}
+
+/**
+ * @brief Simulates the replicates of a job and sends or writes their trees
+ * @details A job whose client has gone away is abandoned at the next replicate
+ *
+ * @param job job to run
+ */
+void SimServer::runJob(Job &job){
+    TreeSimulation sim(job.settings, job.sd1, job.sd2);
+    if(!sim.isValid()){
+        job.conn->send(job.id + "\terror\t" + sim.getErrorMessage() + "\n");
+        return;
+    }
+    std::ofstream out;
+    if(!job.outFile.empty()){
+        out.open(job.outFile);
+        if(!out.is_open()){
+            job.conn->send(job.id + "\terror\tunable to write " + job.outFile + "\n");
+            return;
+        }
+    }
+    SimTrees trees;
+    std::string block, pre;
+    for(int k = 0; k < job.numReps; k++){
+        sim.simulate(trees);
+        pre = job.id + "\t" + std::to_string(k) + "\t";
+        block = pre + "species\t" + trees.speciesTree + "\n";
+        if(!trees.extantSpeciesTree.empty())
+            block += pre + "extant_species\t" + trees.extantSpeciesTree + "\n";
+        for(size_t i = 0; i < trees.locusTrees.size(); i++)
+            block += pre + "locus\t" + std::to_string(i) + "\t" + trees.locusTrees[i] + "\n";
+        for(size_t i = 0; i < trees.geneTrees.size(); i++){
+            for(size_t j = 0; j < trees.geneTrees[i].size(); j++){
+                std::string ij = std::to_string(i) + "\t" + std::to_string(j) + "\t";
+                block += pre + "gene\t" + ij + trees.geneTrees[i][j] + "\n";
+                block += pre + "extant_gene\t" + ij + trees.extantGeneTrees[i][j] + "\n";
+            }
+        }
+        if(out.is_open())
+            out << block;
+        else if(!job.conn->send(block))
+            return;
+    }
+    std::string done = job.id + "\tdone\t" + std::to_string(job.numReps);
+    if(out.is_open()){
+        out.close();
+        done += "\t" + job.outFile;
+    }
+    job.conn->send(done + "\n");
+}
+
+/**
+ * @brief Stops taking connections and jobs, jobs already queued are still run
+ */
+void SimServer::stop(){
+    std::lock_guard<std::mutex> lock(queueMutex);
+    if(stopping)
+        return;
+    stopping = true;
+    queueCond.notify_all();
+    ::shutdown(listenFd, SHUT_RDWR);
+}
+
+/**
+ * @brief Listens on the socket and serves jobs until a client asks the server to shut down
+ *
+ * @return false if the socket could not be set up
+ */
+bool SimServer::run(){
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if(socketPath.size() >= sizeof(addr.sun_path)){
+        std::cerr << "The socket path " << socketPath << " is too long." << std::endl;
+        return false;
+    }
+    strncpy(addr.sun_path, socketPath.c_str(), sizeof(addr.sun_path) - 1);
+    // a socket left behind by a server that did not shut down cleanly
+    struct stat st;
+    if(stat(socketPath.c_str(), &st) == 0 && S_ISSOCK(st.st_mode))
+        unlink(socketPath.c_str());
+    listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(listenFd < 0 || bind(listenFd, (sockaddr*) &addr, sizeof(addr)) < 0 || listen(listenFd, 64) < 0){
+        std::cerr << "Unable to listen on " << socketPath << ": " << strerror(errno) << std::endl;
+        if(listenFd >= 0)
+            close(listenFd);
+        return false;
+    }
+    std::cout << "Listening on " << socketPath << " with " << numWorkers << " workers" << std::endl;
+
+    std::vector<std::thread> workers;
+    for(unsigned t = 0; t < numWorkers; t++)
+        workers.emplace_back(&SimServer::runJobs, this);
+    while(true){
+        int fd = accept(listenFd, nullptr, nullptr);
+        if(fd < 0){
+            std::lock_guard<std::mutex> lock(queueMutex);
+            if(stopping)
+                break;
+            if(errno == EINTR || errno == ECONNABORTED)
+                continue;
+            std::cerr << "Unable to accept a connection on " << socketPath << ": " << strerror(errno) << std::endl;
+            break;
+        }
+        auto conn = std::make_shared<Connection>(fd);
+        std::lock_guard<std::mutex> lock(queueMutex);
+        if(stopping)
+            break;
+        activeReaders++;
+        for(size_t i = 0; i < connections.size(); ){
+            if(connections[i].expired()){
+                connections[i] = connections.back();
+                connections.pop_back();
+            }
+            else
+                i++;
+        }
+        connections.push_back(conn);
+        std::thread(&SimServer::readJobs, this, conn).detach();
+    }
+    this->stop();
+    {
+        std::unique_lock<std::mutex> lock(queueMutex);
+        // readers still waiting on their clients see the end of their input
+        for(auto & c : connections){
+            std::shared_ptr<Connection> open = c.lock();
+            if(open != nullptr)
+                ::shutdown(open->fd, SHUT_RD);
+        }
+        queueCond.wait(lock, [this](){ return activeReaders == 0; });
+    }
+    for(auto & w : workers)
+        w.join();
+    close(listenFd);
+    unlink(socketPath.c_str());
+    std::cout << "Server on " << socketPath << " stopped" << std::endl;
+    return true;
+}
@@ -0,0 +1,67 @@
+#ifndef SimServer_h
+#define SimServer_h
+
+#include "TreeSimulation.h"
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Long running simulation server taking jobs over a local Unix domain socket
+ * @details A client writes one job per line, using the flags of the command line program for the settings of the job:
+ *              -nt -sbr -sdr -gbr -gdr -lgtr -nl -ng -ipp -ne -og -sc -rec -rho -dtwf -istnw -r -sd1 -sd2
+ *          plus -id to name the job (jobs are numbered from 1 on each connection otherwise) and -o to write the trees
+ *          of the job to that file instead of sending them back. Unset settings take the defaults of SimSettings,
+ *          and jobs without -sd1 get seeds drawn from the server's generator in the order they arrive.
+ *
+ *          Jobs from all connections are queued and run by a pool of workers. The trees of each replicate are sent back
+ *          as one block of tab separated lines as soon as it is done, so the replicates of different jobs may be
+ *          interleaved:
+ *              <id> <rep> species <newick>
+ *              <id> <rep> extant_species <newick>
+ *              <id> <rep> locus <i> <newick>
+ *              <id> <rep> gene <i> <j> <newick>
+ *              <id> <rep> extant_gene <i> <j> <newick>
+ *          followed by "<id> done <reps> [<file>]" once the job is finished, or "<id> error <message>". The server
+ *          closes a connection once the client has shut down its side and all of its jobs are done. A line
+ *          "shutdown" stops the server after the jobs already queued.
+ */
+class SimServer{
+    private:
+        struct Connection;
+        struct Job{
+            std::shared_ptr<Connection>     conn;
+            std::string                     id;
+            SimSettings                     settings;
+            int                             numReps = 1;
+            seedType                        sd1 = 0, sd2 = 0;
+            std::string                     outFile;
+        };
+
+        std::string                         socketPath;
+        unsigned                            numWorkers;
+        MbRandom                            rando;
+        int                                 listenFd;
+        std::mutex                          queueMutex;
+        std::condition_variable             queueCond;
+        std::deque<Job>                     jobs;
+        bool                                stopping;
+        unsigned                            activeReaders;
+        std::vector<std::weak_ptr<Connection> > connections;
+
+        bool                                parseJob(const std::string &line, Job &job, std::string &err);
+        void                                readJobs(std::shared_ptr<Connection> conn);
+        void                                runJobs();
+        void                                runJob(Job &job);
+        void                                stop();
+
+    public:
+                                            SimServer(const std::string &path, unsigned nw, seedType sd1, seedType sd2);
+        bool                                run();
+};
+
+#endif /* SimServer_h */
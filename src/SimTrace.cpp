@@ -0,0 +1,109 @@
+#include "SimTrace.h"
+#include <fstream>
+#include <iomanip>
+
+/**
+ * @brief Constructor of the TraceBuffer class
+ *
+ * @param t index of the thread writing to the buffer
+ * @param o time all spans of the run are measured from
+ */
+TraceBuffer::TraceBuffer(unsigned t, std::chrono::steady_clock::time_point o){
+    thread = t;
+    row = -1;
+    origin = o;
+    spans.reserve(1024);
+}
+
+/**
+ * @brief Microseconds since the start of the run
+ */
+double TraceBuffer::now() const{
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - origin).count();
+}
+
+/**
+ * @brief Adds a finished span to the buffer, tagged with the sweep row set by setRow
+ *
+ * @param name name of the span, must be a string literal
+ * @param rep index of the replicate the span belongs to
+ * @param start time the span started in microseconds since the start of the run
+ * @param stop time the span ended in microseconds since the start of the run
+ */
+void TraceBuffer::addSpan(const char *name, int rep, double start, double stop){
+    spans.push_back({name, row, rep, start, stop - start});
+}
+
+/**
+ * @brief Writes the name of the thread and its spans as complete ("X") trace events
+ *
+ * @param out stream to write to
+ * @param first true if no event has been written to the stream yet, set to false once one is
+ */
+void TraceBuffer::writeJson(std::ostream &out, bool &first) const{
+    out << (first ? "\n" : ",\n");
+    out << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << thread;
+    out << ", \"args\": {\"name\": \"worker " << thread << "\"}}";
+    first = false;
+    for(auto & s : spans){
+        out << ",\n{\"name\": \"" << s.name << "\", \"cat\": \"treeducken\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << thread;
+        out << ", \"ts\": " << s.start << ", \"dur\": " << s.duration;
+        out << ", \"args\": {";
+        if(s.row >= 0)
+            out << "\"row\": " << s.row << ", ";
+        out << "\"replicate\": " << s.replicate << "}}";
+    }
+}
+
+/**
+ * @brief Starts a span, the span is added to the buffer when it is destroyed
+ *
+ * @param tb buffer of the thread running the span, nullptr to record nothing
+ * @param n name of the span, must be a string literal
+ * @param rep index of the replicate the span belongs to
+ */
+TraceSpan::TraceSpan(TraceBuffer *tb, const char *n, int rep){
+    buffer = tb;
+    name = n;
+    replicate = rep;
+    start = (buffer != nullptr) ? buffer->now() : 0.0;
+}
+
+TraceSpan::~TraceSpan(){
+    if(buffer != nullptr)
+        buffer->addSpan(name, replicate, start, buffer->now());
+}
+
+/**
+ * @brief Constructor of the RunTrace class
+ *
+ * @param nThreads number of worker threads of the run, 0 to trace nothing
+ */
+RunTrace::RunTrace(unsigned nThreads){
+    std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+    buffers.reserve(nThreads);
+    for(unsigned t = 0; t < nThreads; t++)
+        buffers.emplace_back(t, origin);
+}
+
+/**
+ * @brief Writes the spans of every thread to a Chrome trace-event JSON file, viewable in Perfetto or chrome://tracing
+ * @details Must only be called once the threads writing to the buffers are done
+ *
+ * @param fn name of the file to write
+ * @return false if the file could not be opened
+ */
+bool RunTrace::writeJson(const std::string &fn) const{
+    std::ofstream out(fn);
+    if(!out.is_open()){
+        std::cerr << "Unable to write the trace file " << fn << std::endl;
+        return false;
+    }
+    bool first = true;
+    out << std::fixed << std::setprecision(3);
+    out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+    for(auto & b : buffers)
+        b.writeJson(out, first);
+    out << "\n]}" << std::endl;
+    return true;
+}
@@ -0,0 +1,68 @@
+#ifndef SimTrace_h
+#define SimTrace_h
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Spans recorded by one worker thread for a Chrome trace-event file
+ * @details Each thread of a run writes only to its own buffer, so recording a span takes no lock. The buffers are
+ *          read once all threads are joined. In a parameter sweep the worker sets the row it is running, and the spans
+ *          recorded after that are tagged with it.
+ */
+class TraceBuffer{
+    private:
+        struct Span{
+            const char                          *name;
+            int                                 row;
+            int                                 replicate;
+            double                              start;
+            double                              duration;
+        };
+        unsigned                                thread;
+        int                                     row;
+        std::chrono::steady_clock::time_point   origin;
+        std::vector<Span>                       spans;
+
+    public:
+                                                TraceBuffer(unsigned t, std::chrono::steady_clock::time_point o);
+        double                                  now() const;
+        void                                    setRow(int r) { row = r; }
+        void                                    addSpan(const char *name, int rep, double start, double stop);
+        void                                    writeJson(std::ostream &out, bool &first) const;
+};
+
+/**
+ * @brief Records the wall time from its construction to its destruction as a span of a TraceBuffer
+ * @details Does nothing when the buffer is nullptr, so the Simulator and the Engine can keep spans in place with tracing off
+ */
+class TraceSpan{
+    private:
+        TraceBuffer                             *buffer;
+        const char                              *name;
+        int                                     replicate;
+        double                                  start;
+
+    public:
+                                                TraceSpan(TraceBuffer *tb, const char *n, int rep);
+                                                ~TraceSpan();
+                                                TraceSpan(const TraceSpan&) = delete;
+        TraceSpan&                              operator=(const TraceSpan&) = delete;
+};
+
+/**
+ * @brief One TraceBuffer per worker thread of a run, all timed from the start of the run
+ */
+class RunTrace{
+    private:
+        std::vector<TraceBuffer>                buffers;
+
+    public:
+                                                RunTrace(unsigned nThreads);
+        TraceBuffer*                            getBuffer(unsigned t) { return t < buffers.size() ? &buffers[t] : nullptr; }
+        bool                                    writeJson(const std::string &fn) const;
+};
+
+#endif /* SimTrace_h */
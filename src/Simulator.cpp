@@ -1,5 +1,5 @@
 #include "Simulator.h"
-#include <iostream>
+#include <cmath>
 
 /**
  * Constructor of Simulator class for full three-tree model
@@ -7,7 +7,7 @@
  * @param ntax Number of taxa to simulate
  * @param lambda Rate of birth as double
  * @param mu Rate of death as double
- * @param rho Sampling Fraction (currently not implemented)
+ * @param rho Fraction of the extant species sampled in the extant species tree
  * @param numLociToSim Number of loci to simulate per species tre
  * @param gbr Gene birth rate as double
  * @param gdr Gene death rate as double
@@ -38,15 +38,14 @@ Simulator::Simulator(MbRandom *p,
                      bool sout)
 {
     spTree = nullptr;
-    geneTree = nullptr;
     lociTree = nullptr;
     simType = 3;
     currentSimTime = 0.0;
     rando = p;
     numTaxaToSim = ntax;
-    gsaStop = 100*ntax;
     speciationRate = lambda;
     extinctionRate = mu;
+    setGSAStop();
     samplingRate = rho;
     numLoci = numLociToSim;
     numGenes = ng;
@@ -62,27 +61,185 @@ Simulator::Simulator(MbRandom *p,
     geneTrees.resize(numLoci);
     treeScale = ts;
     propDuplicate = -1;
+    sampleReconstructed = false;
+    dtwfSwitch = 0;
+    profile = nullptr;
+    trace = nullptr;
+    progress = nullptr;
+    traceReplicate = 0;
+    maxNodes = 0;
+    budgetNodes = 0;
+    peakNodes = 0;
+    overBudget = false;
+    gsaRestarts = 0;
+    gsaWastedEvents = 0;
+    gsaSimTree = nullptr;
 }
 /**
  * Destructor for Simulator classes
  */
 Simulator::~Simulator(){
-    for(auto & gsaTree : gsaTrees){
-        delete gsaTree;
+    reset();
+    delete gsaSimTree;
+    for(auto & spareSpeciesTree : spareSpeciesTrees){
+        delete spareSpeciesTree;
     }
-    gsaTrees.clear();
-    int i = 0;
-    for(auto & locusTree : locusTrees){
-        delete locusTree;
-        for(auto & q : geneTrees[i]){
-            delete q;
-        }
-        geneTrees[i].clear();
-        ++i;
+    for(auto & spareLocusTree : spareLocusTrees){
+        delete spareLocusTree;
     }
+    for(auto & spareGeneTree : spareGeneTrees){
+        delete spareGeneTree;
+    }
+}
+
+/**
+ * Clears the trees of the last simulation so the same Simulator can run the next one
+ * @details The species, locus, and gene trees are not freed but kept as spares. They are handed out again with their nodes
+ *          by newSpeciesTree, newLocusTree, and newGeneTree, so a run reusing one Simulator stops allocating trees once it
+ *          has simulated its largest replicate.
+ */
+void Simulator::reset(){
+    spareSpeciesTrees.insert(spareSpeciesTrees.end(), gsaTrees.begin(), gsaTrees.end());
+    gsaTrees.clear();
+    spareLocusTrees.insert(spareLocusTrees.end(), locusTrees.begin(), locusTrees.end());
     locusTrees.clear();
-    
-        
+    for(auto & locusGeneTrees : geneTrees){
+        spareGeneTrees.insert(spareGeneTrees.end(), locusGeneTrees.begin(), locusGeneTrees.end());
+        locusGeneTrees.clear();
+    }
+    spTree = nullptr;
+    lociTree = nullptr;
+    currentSimTime = 0.0;
+    gsaRestarts = 0;
+    gsaWastedEvents = 0;
+    budgetNodes = 0;
+    peakNodes = 0;
+    overBudget = false;
+}
+
+/**
+ * Sets the number of extant lineages at which the GSA stops. From ntax + k lineages the chance of ever getting back
+ * down to ntax is at most (mu/lambda)^k for the largest ratio of the death to the birth rate over the run, so once it
+ * is below 1e-6 no more intervals with ntax lineages will be sampled. With rate functions the ratio is bounded by the
+ * largest death rate over the smallest birth rate; if that bound is not below 1 the GSA stops at 100 * ntax, or once a
+ * tree that sampled an interval goes extinct.
+ */
+void Simulator::setGSAStop(){
+    double maxMu = extinctionRate, minLambda = speciationRate;
+    if(deathRateFunction != nullptr)
+        maxMu = deathRateFunction->getMaxRate();
+    if(birthRateFunction != nullptr)
+        minLambda = birthRateFunction->getMinRate();
+    gsaStop = 100*numTaxaToSim;
+    gsaStopAtExtinction = !(maxMu < minLambda);
+    if(maxMu <= 0.0)
+        gsaStop = numTaxaToSim + 1;
+    else if(maxMu < minLambda){
+        double k = std::ceil(std::log(1e-6) / std::log(maxMu / minLambda));
+        if(numTaxaToSim + k < gsaStop)
+            gsaStop = numTaxaToSim + (unsigned) k;
+    }
+}
+
+/**
+ * Sets the number of extant taxa of the species trees, e.g. when a reused Simulator moves on to an input tree with
+ * another number of tips
+ * @param nt number of extant taxa
+ */
+void Simulator::setNumTaxa(unsigned nt){
+    numTaxaToSim = nt;
+    setGSAStop();
+}
+
+/**
+ * Sets the birth and death rates of the species tree to functions of time, the Simulator owns them
+ * @param b birth rate function, nullptr for the constant birth rate
+ * @param d death rate function, nullptr for the constant death rate
+ */
+void Simulator::setRateFunctions(RateFunction *b, RateFunction *d){
+    birthRateFunction.reset(b);
+    deathRateFunction.reset(d);
+    setGSAStop();
+}
+
+/**
+ * Sets the largest number of nodes the trees of one replicate may use, a replicate going over it is aborted
+ * @param n largest number of nodes, 0 for no limit
+ * @param megabytes largest memory of the nodes in megabytes, converted to a number of nodes with Tree::bytesPerNode,
+ *        0 for no limit
+ */
+void Simulator::setNodeBudget(unsigned long n, double megabytes){
+    maxNodes = n;
+    if(megabytes > 0.0){
+        auto memNodes = (unsigned long) (megabytes * 1048576.0 / Tree::bytesPerNode);
+        if(maxNodes == 0 || memNodes < maxNodes)
+            maxNodes = (memNodes > 0) ? memNodes : 1;
+    }
+}
+
+/**
+ * Checks a number of nodes in use by the replicate against the budget and keeps the largest seen
+ * @param n number of nodes the trees of the replicate use
+ * @return false if n is over the budget, the replicate is then marked as over budget
+ */
+bool Simulator::withinBudget(unsigned long n){
+    if(n > peakNodes)
+        peakNodes = n;
+    if(maxNodes > 0 && n > maxNodes){
+        overBudget = true;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Adds the nodes of a finished tree of the replicate to the nodes in use
+ * @param t tree that is kept until the end of the replicate
+ */
+void Simulator::addToBudget(Tree *t){
+    budgetNodes += t->getNumNodesUsed();
+    withinBudget(budgetNodes);
+}
+
+/**
+ * Returns an empty species tree for a sampled GSA tree, reusing a spare one when there is one
+ * @param nt number of taxa of the tree
+ */
+SpeciesTree* Simulator::newSpeciesTree(unsigned nt){
+    if(spareSpeciesTrees.empty())
+        return new SpeciesTree(rando, nt);
+    SpeciesTree *st = spareSpeciesTrees.back();
+    spareSpeciesTrees.pop_back();
+    st->resetTree(nt);
+    return st;
+}
+
+/**
+ * Returns a locus tree with a single lineage at time 0, reusing a spare one when there is one
+ */
+LocusTree* Simulator::newLocusTree(){
+    if(spareLocusTrees.empty())
+        return new LocusTree(rando, numTaxaToSim, currentSimTime, geneBirthRate, geneDeathRate, transferRate);
+    LocusTree *lt = spareLocusTrees.back();
+    spareLocusTrees.pop_back();
+    lt->resetTree(currentSimTime);
+    return lt;
+}
+
+/**
+ * Returns a gene tree to run a coalescent process in, reusing a spare one when there is one
+ * @details GeneTree::initializeTree empties a reused gene tree
+ */
+GeneTree* Simulator::newGeneTree(){
+    GeneTree *gt;
+    if(spareGeneTrees.empty())
+        gt = new GeneTree(rando, numTaxaToSim, indPerPop, popSize, generationTime);
+    else{
+        gt = spareGeneTrees.back();
+        spareGeneTrees.pop_back();
+    }
+    gt->setDTWFSwitch(dtwfSwitch);
+    return gt;
 }
 
 
@@ -90,30 +247,78 @@ Simulator::~Simulator(){
  * Generalized Sampling Algorithm for generating birth-death trees of the correct length
  *
  * @details Below is the machinery to use GSA sampling (Hartmann 2010) to simulate a species tree. Much of this code is modified from FossilGen (written by Tracy Heath)
+ *          When the tree goes extinct the simulation starts over from a single lineage at time 0, reusing the nodes of the
+ *          extinct tree, and the intervals sampled before the extinction are kept. The number of restarts and the events
+ *          of attempts that went extinct without sampling an interval are counted in gsaRestarts and gsaWastedEvents.
+ *          When the rates give no bound on the death to birth ratio below 1, a tree may never reach gsaStop, so the
+ *          simulation also stops when a tree that sampled an interval goes extinct: it can not return to ntax lineages.
  */
 bool Simulator::gsaBDSim(){
     double timeInterval, sampTime;
     bool treeComplete;
-    auto st = SpeciesTree(rando, numTaxaToSim, speciationRate, extinctionRate);
-    spTree = &st;
+    // the tree of the full process is kept by the Simulator and its nodes reused by the next call
+    if(gsaSimTree == nullptr)
+        gsaSimTree = new SpeciesTree(rando, numTaxaToSim, speciationRate, extinctionRate);
+    else
+        gsaSimTree->restartSimulation();
+    gsaSimTree->setRateFunctions(birthRateFunction.get(), deathRateFunction.get());
+    spTree = gsaSimTree;
     double eventTime;
-    
+    unsigned long numEvents = 0;
+    unsigned long totalEvents = 0, numDeaths = 0;
+    size_t numSampled = gsaTrees.size();
+    gsaRestarts = 0;
+    gsaWastedEvents = 0;
+    currentSimTime = 0.0;
+
     while(gsaCheckStop()){
         eventTime = spTree->getTimeToNextEvent();
-        currentSimTime += eventTime;
-        spTree->ermEvent(currentSimTime);
-        if(spTree->getNumExtant() < 1){
-            treeComplete = false;
-            return treeComplete;
+        // rates decaying to 0 can leave a tree that never changes again, it is started over like an extinct one
+        bool stalled = std::isinf(eventTime);
+        if(!stalled){
+            currentSimTime += eventTime;
+            spTree->ermEvent(currentSimTime);
+            numEvents++;
+            if(!treeWithinBudget(spTree))
+                return false;
+        }
+        if(stalled || spTree->getNumExtant() < 1){
+            if(gsaStopAtExtinction && gsaTrees.size() > numSampled)
+                break;
+            if(gsaTrees.size() == numSampled)
+                gsaWastedEvents += numEvents;
+            gsaRestarts++;
+            totalEvents += numEvents;
+            numDeaths += (unsigned long) spTree->getNumExtinct();
+            if(profile != nullptr)
+                profile->updatePeakNodes(spTree->getNumNodes());
+            numEvents = 0;
+            numSampled = gsaTrees.size();
+            currentSimTime = 0.0;
+            spTree->restartSimulation();
         }
         else if(spTree->getNumExtant() == numTaxaToSim){
             timeInterval = spTree->getTimeToNextEvent();
-            sampTime = rando->uniformRv(0, timeInterval) + currentSimTime;
-            spTree->setPresentTime(sampTime);
-            processGSASim();
+            if(!std::isinf(timeInterval)){
+                sampTime = rando->uniformRv(0, timeInterval) + currentSimTime;
+                spTree->setPresentTime(sampTime);
+                processGSASim();
+            }
         }
         
     }
+    // the tree of the full process keeps its nodes until the next replicate
+    addToBudget(gsaSimTree);
+    totalEvents += numEvents;
+    if(progress != nullptr)
+        progress->addEvents(totalEvents);
+    if(profile != nullptr){
+        numDeaths += (unsigned long) spTree->getNumExtinct();
+        profile->countEvent(SimProfile::Event_SpeciesBirth, totalEvents - numDeaths);
+        profile->countEvent(SimProfile::Event_SpeciesDeath, numDeaths);
+        profile->addGSARestarts(gsaRestarts);
+        profile->updatePeakNodes(spTree->getNumNodes());
+    }
     unsigned gsaRandomTreeID = rando->uniformRv(0, (unsigned) gsaTrees.size() - 1);
     // delete spTree;
     spTree = gsaTrees[gsaRandomTreeID];
@@ -131,6 +336,116 @@ bool Simulator::gsaBDSim(){
     return treeComplete;
 }
 
+/**
+ * Simulates a species tree with the method chosen by setSampleReconstructed
+ * @details Profiled as the GSA phase, the direct sampling of reconstructedBDSim included. Rates that change over time
+ *          are always simulated with the GSA, the direct sampling assumes constant rates.
+ * @return Bool for whether the simulation produced a tree
+ */
+bool Simulator::speciesTreeSim(){
+    SimProfile::Timer timer(profile, SimProfile::Phase_GSA);
+    if(sampleReconstructed && numTaxaToSim > 1 && birthRateFunction == nullptr && deathRateFunction == nullptr)
+        return reconstructedBDSim();
+    return gsaBDSim();
+}
+
+/**
+ * Samples the reconstructed birth-death tree of the extant species directly, without simulating extinct lineages
+ *
+ * @details The time of origin is drawn from its distribution given numTaxaToSim extant species and a uniform prior,
+ *          the conditioning GSA approximates (Hartmann et al. 2010, Stadler 2011). Given the origin, the n - 1 node
+ *          depths are independent (Gernhard 2008) and placed between neighbouring tips of a coalescent point process,
+ *          so the tree is the Cartesian tree of the depths, built with a stack in one pass. The cost is linear in the
+ *          number of taxa and does not depend on the death rate.
+ * @return Bool, always true since the sampled tree can not go extinct
+ */
+bool Simulator::reconstructedBDSim(){
+    unsigned n = numTaxaToSim;
+    double lambda = speciationRate;
+    double mu = extinctionRate;
+    double r = lambda - mu;
+    double u;
+
+    // origin time, its distribution function is (q(t) / q(infinity))^n
+    do{
+        u = rando->uniformRv();
+    }while(u <= 0.0);
+    double z = std::pow(u, 1.0 / n);
+    double tOr;
+    if(std::abs(r) < 1e-12 * lambda)
+        tOr = z / (lambda * (1.0 - z));
+    else{
+        if(r < 0.0)
+            z *= lambda / mu;
+        tOr = std::log((1.0 - z * mu / lambda) / (1.0 - z)) / r;
+    }
+    double c = (std::abs(r) < 1e-12 * lambda) ? 0.0 : (lambda - mu * std::exp(-r * tOr)) / (1.0 - std::exp(-r * tOr));
+
+    auto *tt = newSpeciesTree(n);
+    std::vector<Node*> stack;
+    std::vector<double> stackDepth;
+    Node *sub = nullptr;
+    for(unsigned i = 0; i < n; i++){
+        Node *tip = tt->newNode();
+        tip->setIsTip(true);
+        tip->setIsExtant(true);
+        tip->setIsExtinct(false);
+        tip->setDeathTime(tOr);
+        sub = tip;
+        if(i == n - 1)
+            break;
+
+        // depth of the node between tip i and tip i + 1 by inverting its distribution function given the origin
+        u = rando->uniformRv();
+        double h;
+        if(c == 0.0)
+            h = u * tOr / (1.0 + lambda * tOr * (1.0 - u));
+        else
+            h = -std::log((c - u * lambda) / (c - u * mu)) / r;
+
+        while(!stack.empty() && stackDepth.back() < h){
+            stack.back()->setRdes(sub);
+            sub->setAnc(stack.back());
+            sub = stack.back();
+            stack.pop_back();
+            stackDepth.pop_back();
+        }
+        Node *p = tt->newNode();
+        p->setDeathTime(tOr - h);
+        p->setLdes(sub);
+        sub->setAnc(p);
+        stack.push_back(p);
+        stackDepth.push_back(h);
+    }
+    while(!stack.empty()){
+        stack.back()->setRdes(sub);
+        sub->setAnc(stack.back());
+        sub = stack.back();
+        stack.pop_back();
+        stackDepth.pop_back();
+    }
+    sub->setAsRoot(true);
+    sub->setBirthTime(0.0);
+
+    tt->setRoot(sub);
+    gsaTrees.push_back(tt);
+    addToBudget(tt);
+    spTree = tt;
+    processSpTreeSim();
+    for(auto & node : spTree->getNodes()){
+        if(node != sub)
+            node->setBirthTime(node->getAnc()->getDeathTime());
+    }
+    spTree->setBranchLengths();
+    spTree->setTreeTipNames();
+    currentSimTime = spTree->getCurrentTimeFromExtant();
+    if(treeScale > 0.0){
+        spTree->scaleTree(treeScale, currentSimTime);
+        currentSimTime = treeScale;
+    }
+    return true;
+}
+
 /**
  * Function for checking whether the simulation has reached the stopping point
  * @return Bool for whether to keepSimulating or not
@@ -153,17 +468,20 @@ bool Simulator::gsaCheckStop(){
  * @details this prunes the desired species tree from the larger simulated tree according to Hartmann et al. 2010
  */
 void Simulator::processGSASim(){
-    auto *tt = new SpeciesTree(rando, numTaxaToSim + spTree->getNumExtinct());
+    SimProfile::Timer timer(profile, SimProfile::Phase_Reconstruction);
+    auto *tt = newSpeciesTree(numTaxaToSim + spTree->getNumExtinct());
     this->prepGSATreeForReconstruction();
     Node *simRoot = spTree->getRoot();
     tt->setRoot(simRoot);
     tt->reconstructTreeFromGSASim(simRoot);
-    gsaTrees.push_back(tt);    
+    gsaTrees.push_back(tt);
+    addToBudget(tt);
 }
 
 /**
  * Function for processing the final result of a species tree simulation
  * @details This is performed after the tree is rebuilt using the recursive function reconstructTreeFromGSASim, repopulates the nodes vector in SpeciesTree class
+ *          and, with a sampling fraction below 1, chooses the extant species that are sampled
  *
  * @see reconstructTreeFromGSASim()
  */
@@ -171,7 +489,8 @@ void Simulator::processSpTreeSim(){
     spTree->setSpeciationRate(speciationRate);
     spTree->setExtinctionRate(extinctionRate);
     spTree->popNodes();
-
+    if(samplingRate < 1.0)
+        spTree->sampleExtantSpecies(samplingRate);
 }
 
 /**
@@ -255,7 +574,9 @@ bool Simulator::moranCheckStop(){
 bool Simulator::simSpeciesTree(){
     bool good = false;
     while(!good){
-        good = gsaBDSim();
+        good = speciesTreeSim();
+        if(overBudget)
+            return false;
     }
     if(outgroupFrac > 0.0)
         this->graftOutgroup(spTree, spTree->getTreeDepth());
@@ -267,20 +588,7 @@ bool Simulator::simSpeciesTree(){
  * @return A Newick string
  */
 std::string Simulator::printExtSpeciesTreeNewick(){
-    auto *tt = new SpeciesTree(rando, numTaxaToSim);
-    spTree->getRootFromFlags(false);
-    if(outgroupFrac > 0.0){
-        tt->setOutgroup(spTree->getOutgroup());
-        tt->setRoot(spTree->getOutgroup()->getAnc());
-    }
-    else{
-        tt->setRoot(spTree->getExtantRoot());
-    }
-    tt->setExtantRoot(tt->getRoot());
-    tt->reconstructTreeFromSim(spTree->getRoot());
-    std::string newickTree = tt->printExtNewickTree();
-    delete tt;
-    return newickTree;
+    return spTree->printExtNewickTree();
 }
 
 /**
@@ -296,11 +604,14 @@ std::string Simulator::printSpeciesTreeNewick(){
  * @return a bool indicating if all the simulated trees simulated to completion
  */
 bool Simulator::bdsaBDSim(){
+    SimProfile::Timer timer(profile, SimProfile::Phase_LocusSim);
+    TraceSpan span(trace, "bdsaBDSim", traceReplicate);
     bool treesComplete;
+    unsigned long numSpeciations = 0;
     double stopTime = spTree->getCurrentTimeFromExtant();
     double eventTime;
     bool isSpeciation;
-    lociTree = new LocusTree(rando, numTaxaToSim, currentSimTime, geneBirthRate, geneDeathRate, transferRate);
+    lociTree = newLocusTree();
 
     std::map<int,double> speciesBirthTimes = spTree->getBirthTimesFromNodes();
     std::map<int,double> speciesDeathTimes = spTree->getDeathTimesFromNodes();
@@ -321,6 +632,7 @@ bool Simulator::bdsaBDSim(){
             if(currentSimTime > speciesDeathTimes[(*it)]){
                 isSpeciation = spTree->macroEvent((*it));
                 if(isSpeciation){
+                    numSpeciations++;
                     sibs = spTree->tipwiseStep(*it);
                     lociTree->speciationEvent((*it), speciesDeathTimes[(*it)], sibs);
                     it = contempSpecies.erase(it);
@@ -343,6 +655,8 @@ bool Simulator::bdsaBDSim(){
             }
             
             if(lociTree->getNumExtant() < 1){
+                countLocusTreeEvents(numSpeciations);
+                spareLocusTrees.push_back(lociTree);
                 treesComplete = false;
                 return treesComplete;
             }
@@ -355,17 +669,39 @@ bool Simulator::bdsaBDSim(){
         }
         else{
             lociTree->ermEvent(currentSimTime);
+            if(!treeWithinBudget(lociTree)){
+                spareLocusTrees.push_back(lociTree);
+                return false;
+            }
         }
 
 
 
     }
     lociTree->setPresentTime(currentSimTime);
+    countLocusTreeEvents(numSpeciations);
     treesComplete = true;
 
     return treesComplete;
 }
 
+/**
+ * Adds the events of the locus tree just simulated in lociTree to the progress report and the profile
+ * @param numSpeciations number of species splits the locus tree was split at
+ */
+void Simulator::countLocusTreeEvents(unsigned long numSpeciations){
+    if(progress != nullptr)
+        progress->addEvents(numSpeciations + (unsigned long) (lociTree->getNumberDuplications() +
+                            lociTree->getNumberLosses() + lociTree->getNumberTransfers()));
+    if(profile == nullptr)
+        return;
+    profile->countEvent(SimProfile::Event_GeneBirth, (unsigned long) lociTree->getNumberDuplications());
+    profile->countEvent(SimProfile::Event_GeneDeath, (unsigned long) lociTree->getNumberLosses());
+    profile->countEvent(SimProfile::Event_Transfer, (unsigned long) lociTree->getNumberTransfers());
+    profile->countEvent(SimProfile::Event_Speciation, numSpeciations);
+    profile->updatePeakNodes(lociTree->getNumNodes());
+}
+
 /**
  * Function that calls gsaBDSim and then for each of loci bdsaSim to generate numLoci classes of LocusTree
  * @return a bool indicating if both completed
@@ -376,18 +712,21 @@ bool Simulator::simSpeciesLociTrees(){
     for(unsigned i = 0; i < numLoci; i++){
         while(!good){
             while(!spGood){
-                spGood = gsaBDSim();
+                spGood = speciesTreeSim();
+                if(overBudget)
+                    return false;
             }
             if(outgroupFrac > 0.0)
                 this->graftOutgroup(spTree, spTree->getTreeDepth());
-            if(printSOUT)
-                std::cout << "Simulating loci #" <<  i + 1 << std::endl;
             good = bdsaBDSim();
+            if(overBudget)
+                return false;
         }
         if(outgroupFrac > 0.0)
             this->graftOutgroup(lociTree, lociTree->getTreeDepth());
 
         locusTrees.push_back(lociTree);
+        addToBudget(lociTree);
 
         good = false;
     }
@@ -408,107 +747,136 @@ std::string Simulator::printLocusTreeNewick(int i){
 }
 
 /**
- * Function to create a set of sorted doubles of epochs
- * @details epochs are defined by branching points on the LocusTree and extinction events of nodes dying before present on the locus tree. sorted in reverse order
- * @return A set containing the epoch times of a LocusTree stored in lociTree
+ * Function to create a vector of sorted doubles of epochs
+ * @details epochs are defined by branching points on the LocusTree and the deaths of its tips, whether at present or
+ *          by extinction before it. sorted in reverse order, without repeated times
+ * @param epochs filled with the epoch times of the LocusTree stored in lociTree, its old contents are cleared
  */
-std::set<double, std::greater<double> > Simulator::getEpochs(){
-    std::set<double, std::greater<double> > epochs;
-    std::vector<Node*> lociTreeNodes = lociTree->getNodes();
-    for(auto & lociTreeNode : lociTreeNodes){
-        if(!(lociTreeNode->getIsExtinct())){
-            if(lociTreeNode->getIsTip())
-                epochs.insert(lociTreeNode->getDeathTime());
-            epochs.insert(lociTreeNode->getBirthTime());
-        }
-        else
-            epochs.insert(lociTreeNode->getDeathTime());
+void Simulator::getEpochs(std::vector<double> &epochs){
+    epochs.clear();
+    for(auto & lociTreeNode : lociTree->getNodes()){
+        if(lociTreeNode->getIsTip())
+            epochs.push_back(lociTreeNode->getDeathTime());
+        epochs.push_back(lociTreeNode->getBirthTime());
     }
-    return epochs;
+    std::sort(epochs.begin(), epochs.end(), std::greater<double>());
+    epochs.erase(std::unique(epochs.begin(), epochs.end()), epochs.end());
 }
 
 /**
- * Simulates a censored coalescent process and stores resulting coalescent tree in geneTree
- * @return A bool indicating if the censored coalescent process finished
+ * Simulates numGenes censored coalescent processes in lociTree and stores the resulting coalescent trees in genes
+ * @details The gene trees are simulated together, epoch by epoch and locus by locus, so the epochs, the loci alive
+ *          in each of them and their ancestors are worked out once per locus tree instead of once per gene tree.
+ *          A locus reaching its birth hands its remaining lineages to its ancestor before any locus of the next
+ *          epoch is coalesced.
+ * @param genes vector the gene trees are added to
+ * @return A bool indicating if the censored coalescent processes finished
  */
-bool Simulator::coalescentSim(){
-    bool treeGood = false;
-    geneTree = new GeneTree(rando, numTaxaToSim, indPerPop, popSize, generationTime);
-
-    std::map<int,int> spToLo;
-
-    int ancIndx;
-    int epochCount = 0;
+bool Simulator::coalescentSim(std::vector<GeneTree*> &genes){
+    SimProfile::Timer timer(profile, SimProfile::Phase_Coalescent);
+    TraceSpan span(trace, "coalescentSim", traceReplicate);
+    getEpochs(coalEpochs);
+    const std::vector<double> &epochs = coalEpochs;
+    int numEpochs = (int) epochs.size();
+    const std::vector<Node*> &lociTreeNodes = lociTree->getNodes();
+    int numLociNodes = (int) lociTreeNodes.size();
+    auto epochOf = [&epochs](double t){
+        return (int) std::distance(epochs.begin(), std::lower_bound(epochs.begin(), epochs.end(), t, std::greater<double>()));
+    };
 
-    double stopTime, stopTimeEpoch, stopTimeLoci;
-    bool deathCheck;
-    bool allCoalesced;
-    bool is_ext;
+    // per epoch, loci ending in extinction at its start, loci born at its start and loci alive through it; the
+    // vectors are members so their memory is reused, only the first numEpochs of each are in use
+    std::vector<int> &extantLoci = coalExtantLoci;
+    std::vector< std::vector<int> > &extinctLoci = coalExtinctLoci;
+    std::vector< std::vector<int> > &bornLoci = coalBornLoci;
+    std::vector< std::vector<int> > &contempLoci = coalContempLoci;
+    std::vector<int> &ancIndx = coalAncIndx;
+    extantLoci.clear();
+    if((int) extinctLoci.size() < numEpochs){
+        extinctLoci.resize(numEpochs);
+        bornLoci.resize(numEpochs);
+        contempLoci.resize(numEpochs);
+    }
+    for(int k = 0; k < numEpochs; k++){
+        extinctLoci[k].clear();
+        bornLoci[k].clear();
+        contempLoci[k].clear();
+    }
+    ancIndx.assign(numLociNodes, -1);
+    Node *anc;
+    int birthEpoch, deathEpoch;
+    for(int i = 0; i < numLociNodes; i++){
+        if(lociTreeNodes[i]->getIsExtant())
+            extantLoci.push_back(i);
+        birthEpoch = epochOf(lociTreeNodes[i]->getBirthTime());
+        deathEpoch = epochOf(lociTreeNodes[i]->getDeathTime());
+        if(lociTreeNodes[i]->getIsExtinct() && lociTreeNodes[i]->getIsTip())
+            extinctLoci[deathEpoch].push_back(i);
+        for(int k = deathEpoch; k < birthEpoch; k++)
+            contempLoci[k].push_back(i);
+        anc = lociTreeNodes[i]->getAnc();
+        // the root grafted above an outgroup is not one of the loci
+        if(anc != nullptr && anc->getLindx() >= 0 && anc->getLindx() < numLociNodes && lociTreeNodes[anc->getLindx()] == anc){
+            ancIndx[i] = anc->getLindx();
+            bornLoci[birthEpoch].push_back(i);
+        }
+    }
+    // each gene tree is a binary tree over indPerPop tips per extant and per extinct locus plus the single outgroup
+    // tip, so its size is known before it is simulated
+    unsigned long geneTreeTips = (unsigned long) extantLoci.size() * indPerPop;
+    for(int k = 0; k < numEpochs; k++)
+        geneTreeTips += (unsigned long) extinctLoci[k].size() * indPerPop;
+    if(outgroupFrac != 0.0){
+        extantLoci.push_back(-1);
+        geneTreeTips++;
+    }
+    unsigned long geneTreeNodes = geneTreeTips == 0 ? 0 : 2 * geneTreeTips - 1;
+    if(!withinBudget(budgetNodes + lociTree->getNumNodesUsed() + numGenes * geneTreeNodes))
+        return false;
+    // loci come after their ancestors in the nodes vector, going backwards lets lineages cross zero-length loci
+    for(int k = 0; k < numEpochs; k++)
+        std::reverse(bornLoci[k].begin(), bornLoci[k].end());
 
-    std::set<double, std::greater<double> > epochs = getEpochs();
-    int numEpochs = (int) epochs.size();
-    std::set<int> extinctFolks = lociTree->getExtLociIndx();
-    std::set<int> coalescentBounds = lociTree->getCoalBounds();
-    std::vector< std::vector<int> > contempLoci = lociTree->getExtantLoci(epochs);
-    std::map<int, double> stopTimes = lociTree->getBirthTimesFromNodes();
-    geneTree->initializeTree(contempLoci, *(epochs.begin()));
-    if(outgroupFrac != 0.0)
-        contempLoci[0].pop_back();
-    std::set<int>::iterator extFolksIt;
-
-    for(auto epIter = epochs.begin(); epIter != epochs.end(); ++epIter){
-        currentSimTime = *epIter;
-        if(epochCount != numEpochs - 1){
-            epIter = std::next(epIter, 1);
-            stopTimeEpoch = *epIter;
-            for(int j = 0; j < contempLoci[epochCount].size(); ++j){
-                extFolksIt = extinctFolks.find(contempLoci[epochCount][j]);
-                is_ext = (extFolksIt != extinctFolks.end());
-                if(is_ext){
-                    geneTree->addExtinctSpecies(currentSimTime, contempLoci[epochCount][j]);
-                    extinctFolks.erase(extFolksIt);
-                }
-                stopTimeLoci = stopTimes[contempLoci[epochCount][j]];
-                
-                if(stopTimeLoci > stopTimeEpoch){
-                    stopTime = stopTimeLoci;
-                    deathCheck = true;
-                }
-                else{
-                    stopTime = stopTimeEpoch;
-                    deathCheck = false;
-                }
+    size_t firstGene = genes.size();
+    for(unsigned j = 0; j < numGenes; j++){
+        genes.push_back(newGeneTree());
+        genes.back()->initializeTree(extantLoci, epochs[0]);
+    }
 
-                ancIndx = lociTree->postOrderTraversalStep(contempLoci[epochCount][j]);
-                allCoalesced = geneTree->censorCoalescentProcess(currentSimTime, stopTime, contempLoci[epochCount][j], ancIndx, deathCheck);
-                
-                
-                // if all coalesced remove that loci from the matrix of loci
-                if(allCoalesced){
-                    int check = contempLoci[epochCount][j];
-                    for(int k = epochCount + 1; k < numEpochs; k++){
-                        for(int m = 0; m < contempLoci[k].size(); ++m){
-                            if(contempLoci[k][m] == check){
-                                contempLoci[k].erase(contempLoci[k].begin() + m);
-                                break;
-                            }
-                        }
-                    }
-                }
-            }
-            epIter = std::prev(epIter, 1); 
+    for(int k = 0; k < numEpochs; k++){
+        currentSimTime = epochs[k];
+        for(size_t g = firstGene; g < genes.size(); g++){
+            for(int locus : extinctLoci[k])
+                genes[g]->addExtinctSpecies(currentSimTime, locus);
+            for(int locus : bornLoci[k])
+                genes[g]->moveLineagesToAncestor(locus, ancIndx[locus]);
         }
-        else{
+        if(k == numEpochs - 1){
             // finish coalescing
-            geneTree->rootCoalescentProcess(currentSimTime, outgroupFrac);
-            treeGood = true;
+            for(size_t g = firstGene; g < genes.size(); g++)
+                genes[g]->rootCoalescentProcess(currentSimTime, outgroupFrac);
+        }
+        else{
+            for(int locus : contempLoci[k]){
+                for(size_t g = firstGene; g < genes.size(); g++)
+                    genes[g]->censorCoalescentProcess(currentSimTime, epochs[k + 1], locus);
+            }
         }
-        epochCount++;
     }
 
-    spToLo = lociTree->getLocusToSpeciesMap();
-    geneTree->setIndicesBySpecies(spToLo);
-    return treeGood;
+    std::map<int,int> spToLo = lociTree->getLocusToSpeciesMap();
+    for(size_t g = firstGene; g < genes.size(); g++){
+        genes[g]->setIndicesBySpecies(spToLo);
+        addToBudget(genes[g]);
+        if(progress != nullptr)
+            progress->addEvents((unsigned long) (genes[g]->getNumNodes() - 1) / 2);
+        if(profile != nullptr){
+            // every coalescence adds one node to a binary tree that started with its tips
+            profile->countEvent(SimProfile::Event_Coalescence, (genes[g]->getNumNodes() - 1) / 2);
+            profile->updatePeakNodes(genes[g]->getNumNodes());
+        }
+    }
+    return true;
 }
 
 /**
@@ -521,29 +889,24 @@ bool Simulator::simThreeTree(){
     bool spGood = false;
     bool loGood = false;
     while(!spGood){
-        spGood = gsaBDSim();
-
+        spGood = speciesTreeSim();
+        if(overBudget)
+            return false;
     }
     for(int i = 0; i < numLoci; i++){
         while(!loGood){
-            if(printSOUT)
-                std::cout << "Simulating loci # " <<  i + 1 << std::endl;
             loGood = bdsaBDSim();
+            if(overBudget)
+                return false;
         }
         if(outgroupFrac > 0.0){
             this->graftOutgroup(lociTree, lociTree->getTreeDepth());
         }
-        for(int j = 0; j < numGenes; j++){
-            while(!gGood){
-                if(printSOUT)
-                    std::cout << "Simulating gene # " <<  j + 1 << " of loci # " << i + 1 << std::endl;
-                gGood = coalescentSim();
-            }
-            geneTrees[i].push_back(geneTree);
-
-            gGood = false;
-        }
+        gGood = coalescentSim(geneTrees[i]);
         locusTrees.push_back(lociTree);
+        addToBudget(lociTree);
+        if(overBudget)
+            return false;
         loGood = false;
     }
     if(outgroupFrac > 0.0)
@@ -570,25 +933,7 @@ std::string Simulator::printGeneTreeNewick(int i, int j){
  * @return
  */
 std::string Simulator::printExtantGeneTreeNewick(int i, int j){
-    std::string newickTree;
-    if(geneTrees[i][j]->getExtantNodes().size() > 1){
-        auto *tt = new GeneTree(rando, numTaxaToSim, indPerPop, popSize, generationTime);
-        geneTrees[i][j]->getRootFromFlags(true);
-        if(outgroupFrac > 0.0){
-            tt->setOutgroup(geneTrees[i][j]->getOutgroup());
-            tt->setRoot(geneTrees[i][j]->getOutgroup()->getAnc());
-        }
-        else
-            tt->setRoot(geneTrees[i][j]->getExtantRoot());
-        tt->setExtantRoot(geneTrees[i][j]->getExtantRoot());
-        tt->reconstructTreeFromSim(geneTrees[i][j]->getRoot());
-        newickTree = tt->printExtantNewickTree();
-        delete tt;
-    }
-    else{
-        newickTree = ";";
-    }
-    return newickTree;
+    return geneTrees[i][j]->printExtantNewickTree();
 }
 
 /**
@@ -598,10 +943,10 @@ std::string Simulator::printExtantGeneTreeNewick(int i, int j){
  * @param trDepth Depth of the tree stored at *tr
  */
 void Simulator::graftOutgroup(Tree *tr, double trDepth){
-    auto *rootNode = new Node();
+    auto *rootNode = tr->newNode();
     Node *currentRoot = tr->getRoot();
     rootNode->setBirthTime(currentRoot->getBirthTime());
-    auto *outgroupNode = new Node();
+    auto *outgroupNode = tr->newNode();
     tr->rescaleTreeByOutgroupFrac(outgroupFrac, trDepth);
     double tipTime = tr->getEndTime();
     tr->setNewRootInfo(rootNode, outgroupNode, currentRoot, tipTime);
@@ -618,21 +963,15 @@ bool Simulator::simLocusGeneTrees(){
     bool gGood = false;
     for(int i = 0; i < numLoci; i++){
         while(!loGood){
-            if(printSOUT)
-                std::cout << "Simulating loci # " <<  i + 1 << std::endl;
             loGood = bdsaBDSim();
+            if(overBudget)
+                return false;
         }
-        for(int j = 0; j < numGenes; j++){
-            while(!gGood){
-                if(printSOUT)
-                    std::cout << "Simulating gene # " <<  j + 1 << " of loci # " << i + 1 << std::endl;
-                gGood = coalescentSim();
-            }
-            geneTrees[i].push_back(geneTree);
-
-            gGood = false;
-        }
+        gGood = coalescentSim(geneTrees[i]);
         locusTrees.push_back(lociTree);
+        addToBudget(lociTree);
+        if(overBudget)
+            return false;
         loGood = false;
     }
     return gGood;
@@ -653,14 +992,7 @@ double Simulator::calcSpeciesTreeDepth(){
  * @return The tree depth of the pruned tree
  */
 double Simulator::calcExtantSpeciesTreeDepth(){
-    auto *tt = new SpeciesTree(rando, numTaxaToSim);
-    spTree->getRootFromFlags(false);
-    tt->setRoot(spTree->getExtantRoot());
-    tt->setExtantRoot(tt->getRoot());
-    tt->reconstructTreeFromSim(tt->getExtantRoot());
-    double extTreeDepth = tt->getTreeDepth();
-    delete tt;
-    return extTreeDepth;
+    return spTree->getExtantTreeDepth();
 }
 
 /**
@@ -672,53 +1004,144 @@ double Simulator::calcLocusTreeDepth(int i){
     return locusTrees[i]->getTreeDepth();
 }
 
+/**
+ * Calculates the tree length, treeness, average tip length, and depth of the species tree in one pass
+ * @param trLen tree length of the species tree
+ * @param trNess treeness of the species tree
+ * @param aveTipLen average tip length of the species tree
+ * @param trDepth tree depth of the species tree, as calcSpeciesTreeDepth gives it
+ */
+void Simulator::calcSpeciesTreeLengthStats(double &trLen, double &trNess, double &aveTipLen, double &trDepth){
+    spTree->getTreeLengthStats(trLen, trNess, aveTipLen, trDepth);
+}
+
+/**
+ * Calculates the tree length, treeness, and average tip length averaged across all locus trees
+ * @param trLen average tree length of the locus trees
+ * @param trNess average treeness of the locus trees
+ * @param aveTipLen average tip length of the locus trees
+ */
+void Simulator::calcLocusTreeLengthStats(double &trLen, double &trNess, double &aveTipLen){
+    double len, ness, tipLen, depth;
+    trLen = 0.0;
+    trNess = 0.0;
+    aveTipLen = 0.0;
+    if(locusTrees.empty())
+        return;
+    for(auto & locusTree : locusTrees){
+        locusTree->getTreeLengthStats(len, ness, tipLen, depth);
+        trLen += len;
+        trNess += ness;
+        aveTipLen += tipLen;
+    }
+    trLen /= locusTrees.size();
+    trNess /= locusTrees.size();
+    aveTipLen /= locusTrees.size();
+}
+
+/**
+ * Calculates the average time to the most recent common ancestor across all simulated gene trees, and the average
+ * number of generations of the gene trees of each locus tree
+ * @details The depth of each gene tree is walked once and used for both. Runs without gene trees leave both unset.
+ * @param aveTMRCA average depth of the gene trees
+ * @param aveGenerations average depth of the gene trees of each locus tree in generations
+ * @return false if no gene trees were simulated
+ */
+bool Simulator::calcGeneTreeDepthStats(double &aveTMRCA, std::vector<double> &aveGenerations){
+    double sumTMRCA = 0.0;
+    unsigned numGeneTrees = 0;
+    for(auto & locusGeneTrees : geneTrees)
+        numGeneTrees += (unsigned) locusGeneTrees.size();
+    if(numGeneTrees == 0)
+        return false;
+    aveGenerations.assign(numLoci, 0.0);
+    for(unsigned int i = 0; i < numLoci; i++){
+        for(auto & g : geneTrees[i]){
+            double depth = g->getTreeDepth();
+            sumTMRCA += depth;
+            aveGenerations[i] += depth * popSize;
+        }
+        if(!geneTrees[i].empty())
+            aveGenerations[i] /= geneTrees[i].size();
+    }
+    aveTMRCA = sumTMRCA / numGeneTrees;
+    return true;
+}
+
+/**
+ * Calculates the balance and shape statistics of the species tree with only extant tips
+ * @return TreeStatistics of the extant species tree
+ */
+TreeStatistics Simulator::calcSpeciesTreeStatistics(){
+    TreeStatistics stats;
+    stats.calcStatistics(spTree, true);
+    return stats;
+}
+
+/**
+ * Calculates the balance and shape statistics of the extant gene tree j found in LocusTree i
+ * @param i index of LocusTree in Simulator class
+ * @param j index of GeneTree in Simulator class
+ * @return TreeStatistics of the extant gene tree
+ */
+TreeStatistics Simulator::calcGeneTreeStatistics(int i, int j){
+    TreeStatistics stats;
+    stats.calcStatistics(geneTrees[i][j], true);
+    return stats;
+}
+
+/**
+ * Calculates the discordance between the extant gene tree j found in LocusTree i and the species tree
+ * @details Left undefined when an outgroup was grafted, as the outgroup tips do not belong to a species of the tree
+ * @param i index of LocusTree in Simulator class
+ * @param j index of GeneTree in Simulator class
+ * @return Discordance of the gene tree with the species tree
+ */
+Discordance Simulator::calcGeneTreeDiscordance(int i, int j){
+    Discordance disc;
+    if(outgroupFrac == 0.0)
+        disc.calcDiscordance(spTree, geneTrees[i][j]);
+    return disc;
+}
+
 /**
  * Identifies the average number of transfers of all locus trees found in the vector of constructor LocusTree
  * @return The average transfers of the locus trees simulated for Simulator class
  */
-int Simulator::findNumberTransfers(){
-    auto numberTranfers = 0;
+double Simulator::findNumberTransfers(){
+    double numberTranfers = 0.0;
     for(auto & locusTree : locusTrees){
         numberTranfers += locusTree->getNumberTransfers();
     }
-    return numberTranfers / (int) locusTrees.size();
+    if(locusTrees.empty())
+        return 0.0;
+    return numberTranfers / locusTrees.size();
 } 
 /**
  * Finds the average number of duplications in the simulated LocusTree for Simulator class
  * @return Average number of duplications
  */
-int Simulator::findNumberDuplications(){
-    auto numberDuplications = 0;
+double Simulator::findNumberDuplications(){
+    double numberDuplications = 0.0;
     for(auto & locusTree : locusTrees){
         numberDuplications += locusTree->getNumberDuplications();
     }
-    return numberDuplications / (int) locusTrees.size();
+    if(locusTrees.empty())
+        return 0.0;
+    return numberDuplications / locusTrees.size();
 }
 /**
  * Finds the average number of losses in the simulated LocusTree for Simulator class
  * @return Average number of losses
  */
 
-int Simulator::findNumberLosses(){
-    auto numberLosses = 0;
+double Simulator::findNumberLosses(){
+    double numberLosses = 0.0;
     for(auto & locusTree : locusTrees){
         numberLosses += locusTree->getNumberLosses();
     }
-    return numberLosses / (int) locusTrees.size();
+    if(locusTrees.empty())
+        return 0.0;
+    return numberLosses / locusTrees.size();
 }
-/**
- * Finds average number of generations in gene trees for each locus tree
- * @return Average number of generations
- */
-std::vector<double> Simulator::findAveNumberGenerations(){
-    std::vector<double> numberGenerations;
 
-    for(unsigned int i = 0; i < numLoci; i++){
-        numberGenerations.push_back(0.0);
-        for(auto & g : geneTrees[i]) {
-            numberGenerations[i] += g->getTreeDepth() * popSize;
-        }
-        numberGenerations[i] /= geneTrees[i].size();
-    }
-    return numberGenerations;
-}
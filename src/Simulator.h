@@ -9,6 +9,13 @@
 #ifndef Simulator_h
 #define Simulator_h
 #include "GeneTree.h"
+#include "TreeStatistics.h"
+#include "Discordance.h"
+#include "SimProfile.h"
+#include "SimTrace.h"
+#include "SimProgress.h"
+#include "RateFunction.h"
+#include <memory>
 #include <set>
 #include <map>
 
@@ -19,6 +26,7 @@ class Simulator
         double      currentSimTime;
         unsigned    simType;
         unsigned    numTaxaToSim, gsaStop;
+        bool        gsaStopAtExtinction;
         unsigned    numLoci;
         unsigned    numGenes;
         double      speciationRate, extinctionRate;
@@ -31,12 +39,40 @@ class Simulator
         double      generationTime;
         double      outgroupFrac;
         bool        printSOUT;
+        bool        sampleReconstructed;
+        unsigned    dtwfSwitch;
+        SimProfile  *profile;
+        TraceBuffer *trace;
+        int         traceReplicate;
+        SimProgress *progress;
+        unsigned long   maxNodes;
+        unsigned long   budgetNodes, peakNodes;
+        bool        overBudget;
+        std::unique_ptr<RateFunction>   birthRateFunction, deathRateFunction;
+        unsigned    gsaRestarts;
+        unsigned long   gsaWastedEvents;
         std::vector<SpeciesTree*>   gsaTrees;
         SpeciesTree*    spTree;
         LocusTree*      lociTree;
         std::vector<LocusTree*> locusTrees;
-        GeneTree*       geneTree;
         std::vector<std::vector<GeneTree*> > geneTrees;
+        SpeciesTree*    gsaSimTree;
+        std::vector<SpeciesTree*>   spareSpeciesTrees;
+        std::vector<LocusTree*>     spareLocusTrees;
+        std::vector<GeneTree*>      spareGeneTrees;
+        // scratch of coalescentSim, kept so each locus tree reuses the memory of the last one
+        std::vector<double>         coalEpochs;
+        std::vector<int>            coalExtantLoci, coalAncIndx;
+        std::vector<std::vector<int> >  coalExtinctLoci, coalBornLoci, coalContempLoci;
+
+        SpeciesTree*    newSpeciesTree(unsigned nt);
+        LocusTree*      newLocusTree();
+        GeneTree*       newGeneTree();
+        void            countLocusTreeEvents(unsigned long numSpeciations);
+        bool            withinBudget(unsigned long n);
+        bool            treeWithinBudget(Tree *t) { return maxNodes == 0 || withinBudget(budgetNodes + t->getNumNodesUsed()); }
+        void            addToBudget(Tree *t);
+        void            setGSAStop();
 
     public:
         // Simulating species and locus trees with one gene tree per locus tree
@@ -57,12 +93,32 @@ class Simulator
                 double ts,
                 bool sout);
         ~Simulator();
+        void    reset();
 
         void    setSpeciesTree(SpeciesTree *st) { spTree = st; }
+        void    setNumTaxa(unsigned nt);
+        void    setSampleReconstructed(bool t) { sampleReconstructed = t; }
+        void    setDTWFSwitch(unsigned n) { dtwfSwitch = n; }
+        void    setProfile(SimProfile *p) { profile = p; }
+        void    setTrace(TraceBuffer *tb, int rep) { trace = tb; traceReplicate = rep; }
+        TraceBuffer*    getTrace() { return trace; }
+        void    setProgress(SimProgress *p) { progress = p; }
+        void    setNodeBudget(unsigned long n, double megabytes);
+        void    setRateFunctions(RateFunction *b, RateFunction *d);
+        unsigned long   getMaxNodes() { return maxNodes; }
+        unsigned long   getPeakNodes() { return peakNodes; }
+        bool    isOverBudget() { return overBudget; }
+        SpeciesTree*    getSpeciesTree() { return spTree; }
+        LocusTree*      getLocusTree(int i) { return locusTrees[i]; }
+        GeneTree*       getGeneTree(int i, int j) { return geneTrees[i][j]; }
+        bool    speciesTreeSim();
+        unsigned    getGSARestarts() { return gsaRestarts; }
+        unsigned long   getGSAWastedEvents() { return gsaWastedEvents; }
         bool    gsaBDSim();
+        bool    reconstructedBDSim();
         bool    bdsaBDSim();
         bool    moranSpeciesSim();
-        bool    coalescentSim();
+        bool    coalescentSim(std::vector<GeneTree*> &genes);
         bool    simSpeciesTree();
         bool    simMoranSpeciesTree();
         bool    simSpeciesLociTrees();
@@ -78,16 +134,21 @@ class Simulator
         double  calcSpeciesTreeDepth(); 
         double  calcExtantSpeciesTreeDepth();
         double  calcLocusTreeDepth(int i);
-        int     findNumberTransfers();
-        int     findNumberDuplications();
-        int     findNumberLosses();
-        std::vector<double>  findAveNumberGenerations();
+        void    calcSpeciesTreeLengthStats(double &trLen, double &trNess, double &aveTipLen, double &trDepth);
+        void    calcLocusTreeLengthStats(double &trLen, double &trNess, double &aveTipLen);
+        bool    calcGeneTreeDepthStats(double &aveTMRCA, std::vector<double> &aveGenerations);
+        TreeStatistics  calcSpeciesTreeStatistics();
+        TreeStatistics  calcGeneTreeStatistics(int i, int j);
+        Discordance     calcGeneTreeDiscordance(int i, int j);
+        double  findNumberTransfers();
+        double  findNumberDuplications();
+        double  findNumberLosses();
         std::string    printSpeciesTreeNewick();
         std::string    printExtSpeciesTreeNewick();
         std::string    printLocusTreeNewick(int i);
         std::string    printGeneTreeNewick(int i, int j);
         std::string    printExtantGeneTreeNewick(int i, int j);
-        std::set<double, std::greater<double> > getEpochs();
+        void    getEpochs(std::vector<double> &epochs);
 };
 
 
@@ -7,6 +7,9 @@
 //
 
 #include "SpeciesTree.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
 #include <iostream>
 
 SpeciesTree::SpeciesTree(MbRandom *p, unsigned numTaxa, double br, double dr) : Tree(p, numTaxa, 0.0){
@@ -25,17 +28,60 @@ SpeciesTree::SpeciesTree(MbRandom *p, unsigned numTaxa) : Tree(p, numTaxa){
 
 SpeciesTree::~SpeciesTree() = default;
 
+/**
+ * Puts the tree back to a single lineage at time 0 so a simulation that went extinct can start over
+ * @details The nodes of the extinct tree are kept and handed out again by newNode instead of being freed
+ */
+void SpeciesTree::restartSimulation(){
+    recycleNodes();
+    initializeRoot();
+}
+
+/**
+ * Empties the tree so it can be filled again by reconstructTreeFromGSASim, keeping its nodes for reuse
+ * @param nt number of taxa of the new tree
+ */
+void SpeciesTree::resetTree(unsigned nt){
+    recycleNodes();
+    numTaxa = nt;
+    extantStop = nt;
+}
+
 double SpeciesTree::getTimeToNextEvent(){
+    if(birthRateFunction != nullptr || deathRateFunction != nullptr)
+        return getTimeToNextVaryingEvent();
     double sumRate = speciationRate + extinctionRate;
 
-    double returnTime = -log(rando->uniformRv()) / (double(numExtant) * sumRate);
+    double returnTime = rando->exponentialRv(double(numExtant) * sumRate);
     return returnTime;
 }
 
+/**
+ * Draws the time to the next event when the birth or death rate changes over time
+ * @details Births and deaths are independent Poisson processes with numExtant times their rate, so the next event is the
+ *          earlier of the next birth and the next death, each found by inverting the integral of its rate from
+ *          currentTime. Which of the two it is is kept for ermEvent.
+ * @return the waiting time, infinity if no lineage can give birth or die anymore
+ */
+double SpeciesTree::getTimeToNextVaryingEvent(){
+    auto n = (double) numExtant;
+    double tBirth, tDeath;
+    if(birthRateFunction != nullptr)
+        tBirth = birthRateFunction->getEventTime(currentTime, rando->standardExponentialRv() / n);
+    else
+        tBirth = (speciationRate > 0.0) ? currentTime + rando->exponentialRv(n * speciationRate) : std::numeric_limits<double>::infinity();
+    if(deathRateFunction != nullptr)
+        tDeath = deathRateFunction->getEventTime(currentTime, rando->standardExponentialRv() / n);
+    else
+        tDeath = (extinctionRate > 0.0) ? currentTime + rando->exponentialRv(n * extinctionRate) : std::numeric_limits<double>::infinity();
+    nextEventIsBirth = tBirth <= tDeath;
+    return std::min(tBirth, tDeath) - currentTime;
+}
+
 void SpeciesTree::lineageBirthEvent(unsigned indx){
     Node *sis, *right;
-    right = new Node();
-    sis = new Node();
+    right = newNode();
+    sis = newNode();
     setNewLineageInfo(indx, right, sis);
 }
 
@@ -52,8 +98,13 @@ void SpeciesTree::lineageDeathEvent(unsigned int indx){
 void SpeciesTree::ermEvent(double cTime){
     currentTime = cTime;
     int nodeInd = rando->discreteUniformRv(0, numExtant - 1);
-    double relBr = speciationRate / (speciationRate + extinctionRate);
-    bool isBirth = rando->uniformRv() < relBr;
+    bool isBirth;
+    if(birthRateFunction != nullptr || deathRateFunction != nullptr)
+        isBirth = nextEventIsBirth;
+    else{
+        double relBr = speciationRate / (speciationRate + extinctionRate);
+        isBirth = rando->uniformRv() < relBr;
+    }
     if(isBirth)
         lineageBirthEvent(nodeInd);
     else
@@ -115,7 +166,7 @@ void SpeciesTree::setPresentTime(double currentT){
 
 void SpeciesTree::setTreeInfo(){
   //  double trDepth = this->getTreeDepth();
-    std::set<double> deathTimes;
+    double currentTime = 0.0;
     auto it = nodes.begin();
     (*it)->setBirthTime(0.0);
     (*it)->setDeathTime((*it)->getBranchLength() + (*it)->getBirthTime());
@@ -124,13 +175,11 @@ void SpeciesTree::setTreeInfo(){
     for(; it != nodes.end(); ++it){
         (*it)->setBirthTime((*it)->getAnc()->getDeathTime());
         (*it)->setDeathTime((*it)->getBranchLength() + (*it)->getBirthTime());
-        deathTimes.insert(deathTimes.begin(),(*it)->getBranchLength() + (*it)->getBirthTime());
+        if((*it)->getDeathTime() > currentTime)
+            currentTime = (*it)->getDeathTime();
         (*it)->setIndx((int)std::distance(nodes.begin(), it));
     }
     it = nodes.begin();
-    auto set_iter = deathTimes.end();
-    --set_iter;
-    double currentTime = *(set_iter);
     for(; it != nodes.end(); ++it){
         if((*it)->getIsTip()){
             if(std::abs((*it)->getDeathTime() - currentTime) < 0.1){
@@ -205,15 +254,38 @@ std::string SpeciesTree::printNewickTree(){
     return spTree;
 }
 
+/**
+ * Prints the tree with the lineages that have no extant descendants left out
+ * @details The extant tree is walked in place through the view set by setExtantView, the tree itself is not changed
+ */
 std::string SpeciesTree::printExtNewickTree(){
     std::stringstream ss;
     ss.precision(8);
-    recGetNewickTree(this->getRoot(), ss);
+    Node *r = setExtantView();
+    if(r != nullptr)
+        recGetExtNewickTree(r, ss);
     ss << ";";
     std::string spTree = ss.str();
     return spTree;
 }
 
+void SpeciesTree::recGetExtNewickTree(Node *p, std::stringstream &ss){
+    if(p->getRdes() == nullptr)
+        ss << p->getName();
+    else{
+        double brlen;
+        Node *q = nextNodeInExtantView(p->getLdes(), brlen);
+        ss << "(";
+        recGetExtNewickTree(q, ss);
+        ss << "[&index=" << q->getIndex() << "]" << ":" << brlen;
+        ss << ",";
+        q = nextNodeInExtantView(p->getRdes(), brlen);
+        recGetExtNewickTree(q, ss);
+        ss << "[&index=" << q->getIndex() << "]" << ":" << brlen;
+        ss << ")";
+    }
+}
+
 
 void SpeciesTree::setGSATipTreeFlags(){
     zeroAllFlags();
@@ -283,12 +355,36 @@ void SpeciesTree::recPopNodes(Node *p){
     }
 }
 
+/**
+ * Chooses the extant species kept when only a fraction of them is sampled
+ * @details The species left out are marked unsampled and pruned by setExtantView, in the same pass that prunes the
+ *          extinct lineages, so every output and statistic of the extant tree sees the sample. The round(rho * n)
+ *          species kept, at least one, are drawn uniformly without replacement by a partial Fisher-Yates shuffle of a
+ *          copy of extantNodes, whose order is left as it is.
+ * @param rho fraction of the extant species sampled
+ */
+void SpeciesTree::sampleExtantSpecies(double rho){
+    for(auto & node : extantNodes)
+        node->setIsSampled(rho >= 1.0);
+    if(rho >= 1.0 || extantNodes.empty())
+        return;
+    std::vector<Node*> pool = extantNodes;
+    auto n = (unsigned) pool.size();
+    auto k = (unsigned) std::floor(rho * n + 0.5);
+    if(k < 1)
+        k = 1;
+    for(unsigned i = 0; i < k; i++){
+        unsigned j = (unsigned) rando->discreteUniformRv((int) i, (int) n - 1);
+        std::swap(pool[i], pool[j]);
+        pool[i]->setIsSampled(true);
+    }
+}
+
 void SpeciesTree::reconstructTreeFromGSASim(Node *oRoot){
-    Node *n = new Node();
+    Node n;
     unsigned tipCounter = extantStop;
     unsigned intNodeCounter = 0;
-    reconstructLineageFromGSASim(n, oRoot, tipCounter, intNodeCounter);
-    delete n;
+    reconstructLineageFromGSASim(&n, oRoot, tipCounter, intNodeCounter);
 }
 
 void SpeciesTree::reconstructLineageFromGSASim(Node *currN, Node *prevN, unsigned &tipCounter, unsigned &intNodeCounter){
@@ -310,7 +406,7 @@ void SpeciesTree::reconstructLineageFromGSASim(Node *currN, Node *prevN, unsigne
             }
         }
         
-        p = new Node();
+        p = newNode();
         tipCounter++;
         p->setBranchLength(brlen);
         p->setIsTip(true);
@@ -331,7 +427,7 @@ void SpeciesTree::reconstructLineageFromGSASim(Node *currN, Node *prevN, unsigne
     }
     else{
         if(oFlag > 1){
-            Node *s1 = new Node();
+            Node *s1 = newNode();
             intNodeCounter++;
             if(prevN->getLdes()->getFlag() > 0)
                 reconstructLineageFromGSASim(s1, prevN->getLdes(), tipCounter, intNodeCounter);
@@ -453,7 +549,7 @@ void SpeciesTree::moranEvent(double curTime){
 }
 
 double SpeciesTree::getTimeToNextEventMoran(){
-    return -log(rando->uniformRv()) / (double(numExtant) * speciationRate);
+    return rando->exponentialRv(double(numExtant) * speciationRate);
 }
 
 void SpeciesTree::initializeMoranProcess(unsigned numTaxaToSim){
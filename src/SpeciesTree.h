@@ -11,6 +11,7 @@
 
 #include "MbRandom.h"
 #include "Tree.h"
+#include "RateFunction.h"
 #include <sstream>
 #include <map>
 #include <set>
@@ -21,6 +22,11 @@ class SpeciesTree : public Tree
     
         double        speciationRate{}, extinctionRate{};
         unsigned      extantStop;
+        const RateFunction  *birthRateFunction{nullptr};
+        const RateFunction  *deathRateFunction{nullptr};
+        bool          nextEventIsBirth{};
+
+        double        getTimeToNextVaryingEvent();
 
     public:
                       SpeciesTree(MbRandom *p, unsigned numTaxa, double br, double dr);
@@ -28,6 +34,7 @@ class SpeciesTree : public Tree
         virtual       ~SpeciesTree();
         void          setSpeciationRate(double sr) {speciationRate = sr; }
         void          setExtinctionRate(double er) {extinctionRate = er; }
+        void          setRateFunctions(const RateFunction *b, const RateFunction *d) { birthRateFunction = b; deathRateFunction = d; }
 
         // tree-building functions
         virtual double        getTimeToNextEvent(); 
@@ -38,6 +45,8 @@ class SpeciesTree : public Tree
         void          moranEvent(double curTime); 
         void          setNewLineageInfo(unsigned indx, Node *r, Node *l);
         void          initializeMoranProcess(unsigned numTaxa);
+        void          restartSimulation();
+        void          resetTree(unsigned nt);
     
         // set node parameters across tree
         void          setBranchLengths();
@@ -49,6 +58,7 @@ class SpeciesTree : public Tree
         std::string   printNewickTree();
         std::string   printExtNewickTree();
         static void          recGetNewickTree(Node *p, std::stringstream &ss);
+        static void          recGetExtNewickTree(Node *p, std::stringstream &ss);
     
         // simulation functions
         void          setGSATipTreeFlags();
@@ -56,6 +66,7 @@ class SpeciesTree : public Tree
         void          setTreeInfo();
         void          popNodes();
         void          recPopNodes(Node *p);
+        void          sampleExtantSpecies(double rho);
         void          reconstructLineageFromGSASim(Node *currN, Node *prevN, unsigned &tipCounter, unsigned &intNodeCounter);
       //  void          setSampleFromFlags();
         void          initializeMoranProcess(); // TODO: Write this function
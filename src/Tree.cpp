@@ -16,6 +16,7 @@ Node::Node()
     isExtant = false;
     isDuplication = false;
     isExtinct = false;
+    isSampled = true;
     branchLength = 0.0;
     birthTime = 0.0;
     deathTime = 0.0;
@@ -32,14 +33,7 @@ Tree::Tree(MbRandom *p, unsigned numExta, double curTime){
     rando = p;
     outgrp = nullptr;
     // intialize tree with root
-    root = new Node();
-    root->setAsRoot(true);
-    root->setBirthTime(0.0);
-    root->setIndx(0);
-    root->setIsExtant(true);
-    nodes.push_back(root);
-    extantNodes.push_back(root);
-    numExtant = 1;
+    initializeRoot();
     numTaxa = numExta;
     numExtinct = 0;
     currentTime = curTime;
@@ -81,6 +75,65 @@ Tree::~Tree(){
     //     delete (*p);
     // }
     nodes.clear();
+    for(auto & spareNode : spareNodes){
+        delete spareNode;
+    }
+    spareNodes.clear();
+}
+
+/**
+ * @brief Starts the tree from a single extant root lineage at time 0
+ */
+void Tree::initializeRoot(){
+    root = newNode();
+    root->setAsRoot(true);
+    root->setBirthTime(0.0);
+    root->setIndx(0);
+    root->setIsExtant(true);
+    nodes.push_back(root);
+    extantNodes.push_back(root);
+    numExtant = 1;
+}
+
+/**
+ * @brief Returns a node with default settings, reusing a node given up by recycleNodes when there is one
+ * @details Every node handed out is counted in numNodesUsed until the tree is emptied by recycleNodes, including nodes
+ *          that end up not being part of the tree
+ */
+Node* Tree::newNode(){
+    numNodesUsed++;
+    if(spareNodes.empty())
+        return new Node();
+    Node *p = spareNodes.back();
+    spareNodes.pop_back();
+    *p = Node();
+    return p;
+}
+
+/**
+ * @brief Empties the tree, keeping its nodes so the next tree built in this object can reuse them
+ * @details The nodes kept are the ones reachable from the root, the same nodes the destructor frees
+ */
+void Tree::recycleNodes(){
+    size_t i = spareNodes.size();
+    if(root != nullptr)
+        spareNodes.push_back(root);
+    for(; i < spareNodes.size(); i++){
+        if(spareNodes[i]->getLdes() != nullptr)
+            spareNodes.push_back(spareNodes[i]->getLdes());
+        if(spareNodes[i]->getRdes() != nullptr)
+            spareNodes.push_back(spareNodes[i]->getRdes());
+    }
+    root = nullptr;
+    extantRoot = nullptr;
+    outgrp = nullptr;
+    nodes.clear();
+    extantNodes.clear();
+    numExtant = 0;
+    numExtinct = 0;
+    numTotalTips = 0;
+    currentTime = 0.0;
+    numNodesUsed = 0;
 }
 
 void Tree::clearNodes(Node *currNode){
@@ -117,7 +170,7 @@ void Tree::setExtantTreeFlags(){
     this->zeroAllFlags();
     numTotalTips = 0;
     for(auto & node : nodes){
-        if(node->getIsExtant())
+        if(node->getIsExtant() && node->getIsSampled())
             node->setFlag(1);
     }
     this->setSampleFromFlags();
@@ -152,6 +205,53 @@ double Tree::getTotalTreeLength(){
     return sum;
 }
 
+/**
+ * @brief Calculates the tree length, treeness, average tip length and tree depth in one pass over the tree
+ * @details Treeness is the proportion of the tree length found on internal branches. The root branch is not counted.
+ *          The nodes are visited from the root down with an explicit stack, so a grafted outgroup is included. The
+ *          depth is taken on the way, along the same root to tip path getTreeDepth follows.
+ *
+ * @param treeLength sum of all branch lengths
+ * @param treeNess internal branch length divided by tree length
+ * @param aveTipLen average length of the branches leading to tips
+ * @param treeDepth length of the path from the root to a tip, as given by getTreeDepth
+ */
+void Tree::getTreeLengthStats(double &treeLength, double &treeNess, double &aveTipLen, double &treeDepth){
+    double intLength = 0.0;
+    double tipLength = 0.0;
+    unsigned numTips = 0;
+    treeDepth = 0.0;
+    if(root == nullptr){
+        treeLength = treeNess = aveTipLen = 0.0;
+        return;
+    }
+    // each node with the length of the path from the root down to it
+    std::vector<std::pair<Node*, double> > stack;
+    stack.emplace_back(root, 0.0);
+    Node *depthPath = root;
+    while(!stack.empty()){
+        Node *p = stack.back().first;
+        double pathLength = stack.back().second;
+        stack.pop_back();
+        if(p->getIsTip()){
+            tipLength += p->getBranchLength();
+            numTips++;
+            if(p == depthPath)
+                treeDepth = pathLength;
+            continue;
+        }
+        if(p != root)
+            intLength += p->getBranchLength();
+        if(p == depthPath)
+            depthPath = p->getLdes()->getIsExtinct() ? p->getRdes() : p->getLdes();
+        stack.emplace_back(p->getRdes(), pathLength + p->getRdes()->getBranchLength());
+        stack.emplace_back(p->getLdes(), pathLength + p->getLdes()->getBranchLength());
+    }
+    treeLength = intLength + tipLength;
+    treeNess = (treeLength > 0.0) ? intLength / treeLength : 0.0;
+    aveTipLen = (numTips > 0) ? tipLength / numTips : 0.0;
+}
+
 double Tree::getTreeDepth(){
     double td = 0.0;
     Node *r = this->getRoot();
@@ -168,154 +268,86 @@ double Tree::getTreeDepth(){
     return td;
 }
 
-void Tree::reconstructTreeFromSim(Node *oRoot){
-    Node *n = new Node();
-    unsigned tipCounter = numExtant;
-    unsigned intNodeCounter = 0;
-    reconstructLineageFromSim(n, oRoot, tipCounter, intNodeCounter);
-    delete n;
-}
-
-void Tree::reconstructLineageFromSim(Node *currN, Node *prevN, unsigned &tipCounter, unsigned &intNodeCounter){
-    Node *p = nullptr;
-    bool rootN = prevN->getIsRoot();
-    double brlen = prevN->getBranchLength();
-    int oFlag = prevN->getFlag();
-    if(prevN->getIsTip() && oFlag == 1){
-        // need to recalculate branchlength
-        Node *prevAnc = prevN->getAnc();
-        int ancFlag = prevAnc->getFlag();
-        if(ancFlag == 1){
-            brlen += prevAnc->getBranchLength();
-            while(!prevAnc->getIsRoot() && ancFlag < 2){
-                prevAnc = prevAnc->getAnc();
-                ancFlag = prevAnc->getFlag();
-                if(ancFlag == 1)
-                    brlen += prevAnc->getBranchLength();
-            }
-        }
-        
-        p = new Node();
-        tipCounter++;
-        p->setBranchLength(brlen);
-        p->setIsTip(true);
-        p->setName(prevN->getName());
-        p->setBirthTime(prevN->getBirthTime());
-        p->setDeathTime(prevN->getDeathTime());
-        p->setIsExtant(prevN->getIsExtant());
-        p->setIsExtinct(prevN->getIsExtinct());
-        p->setAnc(currN);
-        if(currN->getLdes() == nullptr)
-            currN->setLdes(p);
-        else if(currN->getRdes() == nullptr)
-            currN->setRdes(p);
+/**
+ * @brief Marks the extant tree in the flags of the nodes so it can be walked without copying it
+ * @details After the call the flag of a tip is 1 if it is extant and sampled and 0 otherwise, and the flag of an internal
+ *          node is the number of its subtrees holding such tips. The extant tree is made of these tips and the nodes with
+ *          flag 2; the nodes with flag 1 lie on its branches and are stepped over by nextNodeInExtantView. Extant tips
+ *          left out of an incomplete sample are pruned by the same pass. The flags are set from the root down without
+ *          using the nodes vector or the isRoot marks, which are left unchanged.
+ * @return the root of the extant tree, also kept as the extant root, or nullptr if no tip is extant and sampled
+ */
+Node* Tree::setExtantView(){
+    extantRoot = nullptr;
+    viewNodes.clear();
+    if(root == nullptr)
+        return nullptr;
+    viewNodes.push_back(root);
+    for(size_t i = 0; i < viewNodes.size(); i++){
+        if(viewNodes[i]->getLdes() != nullptr)
+            viewNodes.push_back(viewNodes[i]->getLdes());
+        if(viewNodes[i]->getRdes() != nullptr)
+            viewNodes.push_back(viewNodes[i]->getRdes());
+    }
+    // descendants come after their ancestors in viewNodes
+    for(auto it = viewNodes.rbegin(); it != viewNodes.rend(); ++it){
+        Node *p = *it;
+        if(p->getLdes() == nullptr && p->getRdes() == nullptr)
+            p->setFlag((p->getIsExtant() && p->getIsSampled()) ? 1 : 0);
         else{
-            std::cerr << "ERROR: Problem adding a tip to the tree!" << std::endl;
-            exit(1);
+            int flag = 0;
+            if(p->getLdes() != nullptr && p->getLdes()->getFlag() > 0)
+                flag++;
+            if(p->getRdes() != nullptr && p->getRdes()->getFlag() > 0)
+                flag++;
+            p->setFlag(flag);
         }
-        
     }
-    else{
-        if(oFlag > 1){
-            Node *s1 = new Node();
-            intNodeCounter++;
-            if(prevN->getLdes()->getFlag() > 0)
-                reconstructLineageFromSim(s1, prevN->getLdes(), tipCounter, intNodeCounter);
-            if(prevN->getRdes()->getFlag() > 0)
-                reconstructLineageFromSim(s1, prevN->getRdes(), tipCounter, intNodeCounter);
-            
-            
-            if(!rootN){
-                Node *prevAnc = prevN->getAnc();
-                int ancFlag = prevAnc->getFlag();
-                if(ancFlag == 1){
-                    brlen += prevAnc->getBranchLength();
-                    while(!(prevAnc)->getIsRoot() && ancFlag < 2){
-                        prevAnc = prevAnc->getAnc();
-                        ancFlag = prevAnc->getFlag();
-                        if(ancFlag == 1)
-                            brlen += prevAnc->getBranchLength();
-                    }
-                }
-                
-                if(currN != nullptr){
-                    s1->setBranchLength(brlen);
-                    s1->setBirthTime(prevN->getBirthTime());
-                    s1->setDeathTime(prevN->getDeathTime());
-                    s1->setAnc(currN);
-                    if(currN->getLdes() == nullptr)
-                        currN->setLdes(s1);
-                    else if(currN->getRdes() == nullptr)
-                        currN->setRdes(s1);
-                    else{
-                        std::cerr << "ERROR: Probem adding an internal node to the tree" << std::endl;
-                        exit(1);
-                    }
-                }
-                else{
-                    s1->setAsRoot(true);
-                    setRoot(s1);
-                    s1->setBranchLength(brlen);
-                    s1->setBirthTime(prevN->getBirthTime());
-                    s1->setDeathTime(prevN->getDeathTime());
-                }
-                
-            }
-            else{
-                s1->setAsRoot(true);
-                setRoot(s1);
-                s1->setBranchLength(0.0);
-                s1->setBirthTime(prevN->getBirthTime());
-                s1->setDeathTime(prevN->getDeathTime());
-            }
+    if(root->getFlag() == 0)
+        return nullptr;
+    double brlen;
+    extantRoot = nextNodeInExtantView(root, brlen);
+    return extantRoot;
+}
 
-        }
-        else if(oFlag == 1){
-            if(prevN->getRdes()->getFlag() == 0 && prevN->getLdes()->getFlag() > 0)
-                reconstructLineageFromSim(currN, prevN->getLdes(), tipCounter, intNodeCounter);
-            else
-                reconstructLineageFromSim(currN, prevN->getRdes(), tipCounter, intNodeCounter);
-        }
+/**
+ * @brief Steps from a node to the next node of the extant tree marked by setExtantView
+ * @details Walks down through nodes with a single extant subtree, adding up their branch lengths
+ *
+ * @param p node to start from, with extant descendants
+ * @param brlen set to the length of the extant tree branch ending at the returned node, counted from the branch of p
+ * @return Node* the tip or node with flag 2 ending the branch
+ */
+Node* Tree::nextNodeInExtantView(Node *p, double &brlen){
+    brlen = p->getBranchLength();
+    while(p->getFlag() == 1 && (p->getLdes() != nullptr || p->getRdes() != nullptr)){
+        if(p->getLdes() != nullptr && p->getLdes()->getFlag() > 0)
+            p = p->getLdes();
+        else
+            p = p->getRdes();
+        brlen += p->getBranchLength();
     }
+    return p;
 }
-// Gene tree version only 
-void Tree::getRootFromFlags(bool isGeneTree){
-    Node *p;
-
-	setExtantTreeFlags();
-    int numNodes = (int) nodes.size() - 1;
-    if(isGeneTree){
-        for(int i=numNodes; i > 0; i--){
-            p = nodes[i];
-            if(p->getFlag() >= 2){
-                extantRoot = p;
-                p->setAsRoot(true);
-                break;
-            }
-            
-        }
-    }
-    else{
-        if(outgrp != nullptr){
-            p = nodes[0]->getAnc();
-            extantRoot = p;
-            p->setAsRoot(true);
-        }
-        else{
-            // p = nodes[0];
-            // extantRoot = p;
-            // p->setAsRoot(true);
-            for(int i=0; i < numNodes; i++){
-                p = nodes[i];
-                if(p->getFlag() >= 2){
-                    extantRoot = p;
-                    p->setAsRoot(true);
-                    break;
-                }
-                
-            }
-        }
+
+/**
+ * @brief Calculates the depth of the extant tree from its root to a tip, following left descendants
+ * @return The depth of the extant tree, 0 if no tip is extant
+ */
+double Tree::getExtantTreeDepth(){
+    double td = 0.0;
+    double brlen;
+    Node *p = setExtantView();
+    if(p == nullptr)
+        return td;
+    while(p->getLdes() != nullptr || p->getRdes() != nullptr){
+        if(p->getLdes() != nullptr && p->getLdes()->getFlag() > 0)
+            p = nextNodeInExtantView(p->getLdes(), brlen);
+        else
+            p = nextNodeInExtantView(p->getRdes(), brlen);
+        td += brlen;
     }
+    return td;
 }
 
 void Tree::rescaleTreeByOutgroupFrac(double outgroupFrac, double treeDepth){
@@ -21,6 +21,7 @@ class Node
         bool    isRoot;
         bool    isTip;
         bool    isExtant, isExtinct;
+        bool    isSampled;
         bool    isDuplication;
         double  birthTime, deathTime;
         double  branchLength;
@@ -35,6 +36,7 @@ class Node
         void    setDeathTime(double dt) {deathTime = dt; }
         void    setIsExtant(bool t) {isExtant = t; }
         void    setIsExtinct(bool t) {isExtinct = t; }
+        void    setIsSampled(bool t) {isSampled = t; }
         void    setLdes(Node *l) {ldes = l; }
         void    setRdes(Node *r) {rdes = r; }
         void    setAnc(Node *a) {anc = a; }
@@ -55,6 +57,7 @@ class Node
         bool    getIsTip() {return isTip; }
         bool    getIsExtinct() {return isExtinct; }
         bool    getIsExtant() { return isExtant; }
+        bool    getIsSampled() { return isSampled; }
         std::string getName() { return name; }
         double  getBranchLength() { return branchLength; }
         double  getDeathTime() {return deathTime; }
@@ -78,8 +81,14 @@ class Tree
         unsigned numExtant{}, numExtinct{};
         double  currentTime{};
         MbRandom *rando;
+        std::vector<Node*> spareNodes;
+        std::vector<Node*> viewNodes;
+        size_t  numNodesUsed{};
 
     public:
+        // memory of a node and the pointers to it in nodes and extantNodes
+        static const size_t bytesPerNode = sizeof(Node) + 2 * sizeof(Node*);
+
                     Tree(MbRandom *p, unsigned numExtant, double cTime);
                     Tree(MbRandom *p, unsigned numTaxa);
         virtual      ~Tree();
@@ -94,23 +103,30 @@ class Tree
 
         double      getTotalTreeLength();
         double      getTreeDepth();
+        void        getTreeLengthStats(double &treeLength, double &treeNess, double &aveTipLen, double &treeDepth);
 
         virtual double      getCurrentTime() {return currentTime; }
         double      getEndTime();
         void        rescaleTreeByOutgroupFrac(double outgroupFrac, double getTreeDepth);
         static void        clearNodes(Node *cur);
+        void        initializeRoot();
+        Node*       newNode();
+        void        recycleNodes();
         void        zeroAllFlags();
         void        setWholeTreeFlags();
         void        setExtantTreeFlags();
         void        setSampleFromFlags();
-        void        getRootFromFlags(bool isGeneTree = false);
+        Node*       setExtantView();
+        static Node*    nextNodeInExtantView(Node *p, double &brlen);
+        double      getExtantTreeDepth();
         void        getExtantTree();
         void        setNewRootInfo(Node *newRoot, Node *outgroup, Node *oldRoot, double t);
-        std::vector<Node*> getNodes() { return nodes; }
+        const std::vector<Node*>&   getNodes() { return nodes; }
+        size_t      getNumNodes() { return nodes.size(); }
+        size_t      getNumNodesUsed() { return numNodesUsed; }
+        size_t      getNumBytesUsed() { return numNodesUsed * bytesPerNode; }
         std::vector<Node*> getExtantNodes() { return extantNodes; }
         void        scaleTree( double treeScale , double currtime);
-        void        reconstructTreeFromSim(Node *oRoot);
-        void        reconstructLineageFromSim(Node *currN, Node *prevN, unsigned &tipCounter, unsigned &intNodeCounter);
     
         virtual double  getTimeToNextEvent() { return 0.0; }
         virtual void    lineageBirthEvent(unsigned int indx) { }
@@ -0,0 +1,274 @@
+#include "TreeFileReader.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <fcntl.h>
+#include <strings.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * @brief Constructor of the TreeFileReader class
+ */
+TreeFileReader::TreeFileReader(){
+    mappedFile = nullptr;
+    mappedLength = 0;
+    cur = nullptr;
+    last = nullptr;
+    isNexus = false;
+    inTreesBlock = false;
+    numTreesRead = 0;
+}
+
+/**
+ * @brief Destructor of the TreeFileReader class
+ */
+TreeFileReader::~TreeFileReader(){
+    closeFile();
+}
+
+/**
+ * @brief Unmaps or frees the file that is open, pointers handed out by nextTree are no longer valid afterwards
+ */
+void TreeFileReader::closeFile(){
+    if(mappedFile != nullptr)
+        munmap(mappedFile, mappedLength);
+    mappedFile = nullptr;
+    mappedLength = 0;
+    std::string().swap(fileContents);
+    cur = nullptr;
+    last = nullptr;
+}
+
+/**
+ * @brief Memory maps a regular file read only
+ *
+ * @param fn name of the file
+ * @return true if the file was mapped, false if it is not a regular file or could not be mapped
+ */
+bool TreeFileReader::mapFile(const std::string &fn){
+    int fd = open(fn.c_str(), O_RDONLY);
+    if(fd < 0)
+        return false;
+    struct stat st;
+    if(fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0){
+        close(fd);
+        return false;
+    }
+    void *addr = mmap(nullptr, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping stays valid after the descriptor is closed
+    close(fd);
+    if(addr == MAP_FAILED)
+        return false;
+    madvise(addr, (size_t) st.st_size, MADV_SEQUENTIAL);
+    mappedFile = addr;
+    mappedLength = (size_t) st.st_size;
+    cur = (const char*) addr;
+    last = cur + mappedLength;
+    return true;
+}
+
+/**
+ * @brief Opens a tree file and checks whether it is a NEXUS file
+ *
+ * @param fn name of the file
+ * @return true if the file could be read
+ */
+bool TreeFileReader::openFile(const std::string &fn){
+    closeFile();
+    if(!mapFile(fn)){
+        std::ifstream in(fn, std::ios::in | std::ios::binary);
+        if(!in.is_open()){
+            errorMsg = "Unable to open tree file " + fn;
+            return false;
+        }
+        std::stringstream ss;
+        ss << in.rdbuf();
+        fileContents = ss.str();
+        cur = fileContents.data();
+        last = fileContents.data() + fileContents.size();
+    }
+    numTreesRead = 0;
+    inTreesBlock = false;
+    translateTable.reset();
+    errorMsg.clear();
+
+    skipSpaceAndComments();
+    isNexus = (last - cur >= 6 && strncasecmp(cur, "#nexus", 6) == 0);
+    if(isNexus)
+        cur += 6;
+    return true;
+}
+
+/**
+ * @brief Moves past whitespace and comments in square brackets
+ */
+void TreeFileReader::skipSpaceAndComments(){
+    while(cur < last){
+        if(isspace((unsigned char) *cur))
+            ++cur;
+        else if(*cur == '['){
+            while(cur < last && *cur != ']')
+                ++cur;
+            if(cur < last)
+                ++cur;
+        }
+        else
+            break;
+    }
+}
+
+/**
+ * @brief Reads the next NEXUS word or quoted string, the token is empty if the next character is punctuation
+ *
+ * @param tok string filled with the token
+ */
+void TreeFileReader::readToken(std::string &tok){
+    tok.clear();
+    skipSpaceAndComments();
+    if(cur < last && *cur == '\''){
+        for(++cur; cur < last; ++cur){
+            if(*cur == '\''){
+                if(cur + 1 < last && *(cur + 1) == '\''){
+                    tok += '\'';
+                    ++cur;
+                }
+                else{
+                    ++cur;
+                    break;
+                }
+            }
+            else
+                tok += *cur;
+        }
+        return;
+    }
+    while(cur < last && !isspace((unsigned char) *cur) && strchr(";=,[", *cur) == nullptr)
+        tok += *cur++;
+}
+
+/**
+ * @brief Finds the semicolon ending the current statement, semicolons in comments or quotes are skipped
+ * @return const char* pointer to the semicolon, or to the end of the file
+ */
+const char* TreeFileReader::findStatementEnd(){
+    const char *p = cur;
+    while(p < last && *p != ';'){
+        if(*p == '['){
+            while(p < last && *p != ']')
+                ++p;
+        }
+        else if(*p == '\''){
+            for(++p; p < last && *p != '\''; ++p)
+                ;
+        }
+        if(p < last)
+            ++p;
+    }
+    return p;
+}
+
+/**
+ * @brief Reads a translate statement of a trees block into a new translate table
+ * @return true if the statement was read
+ */
+bool TreeFileReader::readTranslateTable(){
+    auto table = std::make_shared<TranslateTable>();
+    std::string key, val;
+    while(true){
+        readToken(key);
+        if(key.empty()){
+            if(cur < last && *cur == ';'){
+                ++cur;
+                break;
+            }
+            errorMsg = "Could not read the translate table of the trees block";
+            return false;
+        }
+        readToken(val);
+        (*table)[key] = val;
+        skipSpaceAndComments();
+        if(cur < last && *cur == ',')
+            ++cur;
+        else if(cur < last && *cur == ';'){
+            ++cur;
+            break;
+        }
+        else{
+            errorMsg = "Could not read the translate table of the trees block";
+            return false;
+        }
+    }
+    translateTable = table;
+    return true;
+}
+
+/**
+ * @brief Finds the next tree of the file
+ *
+ * @param begin set to the first character of the Newick string
+ * @param end set to one past the last character of the Newick string
+ * @param name set to the name of the tree in a NEXUS file, empty for Newick files
+ * @return true if a tree was found, false at the end of the file or on an error (see getErrorMessage)
+ */
+bool TreeFileReader::nextTree(const char *&begin, const char *&end, std::string &name){
+    name.clear();
+    if(cur == nullptr)
+        return false;
+    if(!isNexus){
+        skipSpaceAndComments();
+        if(cur >= last)
+            return false;
+        begin = cur;
+        end = findStatementEnd();
+        cur = (end < last) ? end + 1 : last;
+        numTreesRead++;
+        return true;
+    }
+
+    std::string tok;
+    while(true){
+        readToken(tok);
+        if(tok.empty()){
+            if(cur >= last)
+                return false;
+            ++cur;
+            continue;
+        }
+        std::transform(tok.begin(), tok.end(), tok.begin(), ::tolower);
+        if(tok == "begin"){
+            readToken(tok);
+            std::transform(tok.begin(), tok.end(), tok.begin(), ::tolower);
+            inTreesBlock = (tok == "trees");
+        }
+        else if(tok == "end" || tok == "endblock")
+            inTreesBlock = false;
+        else if(inTreesBlock && tok == "translate"){
+            if(!readTranslateTable())
+                return false;
+            continue;
+        }
+        else if(inTreesBlock && (tok == "tree" || tok == "utree")){
+            readToken(name);
+            if(name == "*")
+                readToken(name);
+            skipSpaceAndComments();
+            if(cur >= last || *cur != '='){
+                errorMsg = "Expected '=' after the name of tree " + name;
+                return false;
+            }
+            ++cur;
+            begin = cur;
+            end = findStatementEnd();
+            cur = (end < last) ? end + 1 : last;
+            numTreesRead++;
+            return true;
+        }
+        cur = findStatementEnd();
+        if(cur < last)
+            ++cur;
+    }
+}
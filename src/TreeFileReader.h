@@ -0,0 +1,47 @@
+#ifndef TreeFileReader_h
+#define TreeFileReader_h
+
+#include "NewickParser.h"
+#include <memory>
+#include <string>
+
+/**
+ * @brief Steps through the trees of a NEXUS or Newick file one at a time
+ * @details Only the boundaries of each tree are found when the next tree is asked for; reading the tree itself is left
+ *          to NewickParser. In a NEXUS file the trees are the tree statements of the trees block and the translate table
+ *          of that block is kept so tip names can be looked up. Any other file is read as Newick trees ending with ';'.
+ *          A new translate table replaces the old one without changing it, so trees handed out earlier can still use theirs.
+ *          Regular files are memory mapped and trees are handed out as pointers into the mapping, so the text of a large
+ *          file is never copied; anything that cannot be mapped (e.g. a pipe) is read into memory instead.
+ */
+class TreeFileReader{
+    private:
+        std::string                             fileContents;
+        void                                    *mappedFile;
+        size_t                                  mappedLength;
+        const char                              *cur, *last;
+        bool                                    isNexus, inTreesBlock;
+        unsigned                                numTreesRead;
+        std::string                             errorMsg;
+        std::shared_ptr<const TranslateTable>   translateTable;
+
+        void                                    skipSpaceAndComments();
+        void                                    readToken(std::string &tok);
+        const char*                             findStatementEnd();
+        bool                                    readTranslateTable();
+        bool                                    mapFile(const std::string &fn);
+
+    public:
+                                                TreeFileReader();
+                                                ~TreeFileReader();
+                                                TreeFileReader(const TreeFileReader &) = delete;
+        TreeFileReader&                         operator=(const TreeFileReader &) = delete;
+        bool                                    openFile(const std::string &fn);
+        void                                    closeFile();
+        bool                                    nextTree(const char *&begin, const char *&end, std::string &name);
+        unsigned                                getNumTreesRead() { return numTreesRead; }
+        std::string                             getErrorMessage() { return errorMsg; }
+        std::shared_ptr<const TranslateTable>   getTranslateTable() { return translateTable; }
+};
+
+#endif /* TreeFileReader_h */
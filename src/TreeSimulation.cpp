@@ -0,0 +1,158 @@
+#include "TreeSimulation.h"
+#include "NewickParser.h"
+
+/**
+ * @brief Constructor of the TreeSimulation class
+ * @details Checks the settings the same way the command line program does. If they are invalid, or the given species
+ *          tree can not be read, isValid is false and getErrorMessage says why.
+ *
+ * @param s settings of the simulation
+ * @param sd1 first seed of the random number generator
+ * @param sd2 second seed of the random number generator, 0 to derive both seeds from sd1
+ */
+TreeSimulation::TreeSimulation(const SimSettings &s, seedType sd1, seedType sd2){
+    settings = s;
+    rando.setSeed(sd1, sd2);
+    treesim = nullptr;
+    inputSpTree = nullptr;
+    bool genes = settings.numLoci > 0 && settings.popSize > 0 && settings.indPerPop > 0 &&
+                 (settings.indPerPop <= settings.popSize || settings.dtwfSwitch > 0);
+    if(!settings.speciesTree.empty()){
+        NewickParser parser;
+        inputSpTree = parser.parseSpeciesTree(settings.speciesTree, &rando);
+        if(inputSpTree == nullptr){
+            errorMessage = "The species tree is not formatted properly. " + parser.getErrorMessage();
+            return;
+        }
+        if(settings.samplingFraction < 1.0){
+            errorMessage = "The sampling fraction only applies to simulated species trees, it must be 1 with a given species tree.";
+            return;
+        }
+        if(!genes){
+            errorMessage = "Simulating on a species tree needs loci, and a population size and individuals per population "
+                           "with individuals per population at most the population size unless dtwfSwitch is set.";
+            return;
+        }
+        settings.numTaxa = (int) parser.getNumTips();
+        simType = 4;
+    }
+    else if(settings.spBirthRate <= 0.0 || settings.spDeathRate < 0.0 || settings.numTaxa < 2){
+        errorMessage = "Species trees need a positive birth rate, a non-negative death rate, and at least 2 taxa.";
+        return;
+    }
+    else if(settings.numLoci <= 0)
+        simType = 1;
+    else if(genes)
+        simType = 3;
+    else
+        simType = 2;
+    if(settings.numLoci < 0 || settings.numGenes < 0 || settings.geneBirthRate < 0.0 || settings.geneDeathRate < 0.0 ||
+       settings.transferRate < 0.0){
+        errorMessage = "The numbers of loci and genes and the gene birth, death, and transfer rates can not be negative.";
+        return;
+    }
+    if(settings.samplingFraction <= 0.0 || settings.samplingFraction > 1.0){
+        errorMessage = "The sampling fraction must be in (0, 1].";
+        return;
+    }
+
+    treesim = new Simulator(&rando,
+                            (unsigned) settings.numTaxa,
+                            settings.spBirthRate,
+                            settings.spDeathRate,
+                            settings.samplingFraction,
+                            (unsigned) settings.numLoci,
+                            settings.geneBirthRate,
+                            settings.geneDeathRate,
+                            settings.transferRate,
+                            (unsigned) settings.indPerPop,
+                            (unsigned) settings.popSize,
+                            settings.generationTime,
+                            settings.numGenes,
+                            settings.outgroupFrac,
+                            settings.treeScale,
+                            false);
+    treesim->setSampleReconstructed(settings.sampleReconstructed);
+    treesim->setDTWFSwitch(settings.dtwfSwitch);
+}
+
+TreeSimulation::~TreeSimulation(){
+    delete treesim;
+    delete inputSpTree;
+}
+
+/**
+ * @brief Simulates one replicate, the trees of the last replicate are recycled first
+ *
+ * @return false if the settings are invalid
+ */
+bool TreeSimulation::simulate(){
+    if(treesim == nullptr)
+        return false;
+    treesim->reset();
+    switch(simType){
+        case 1:
+            treesim->simSpeciesTree();
+            break;
+        case 2:
+            treesim->simSpeciesLociTrees();
+            break;
+        case 3:
+            treesim->simThreeTree();
+            break;
+        default:
+            treesim->setSpeciesTree(inputSpTree);
+            treesim->simLocusGeneTrees();
+            break;
+    }
+    return true;
+}
+
+/**
+ * @brief Simulates one replicate and hands its trees to a visitor, species tree first, then each locus tree
+ *        followed by its gene trees
+ *
+ * @param visitor receives the trees
+ * @return false if the settings are invalid
+ */
+bool TreeSimulation::simulate(SimVisitor &visitor){
+    if(!simulate())
+        return false;
+    visitor.visitSpeciesTree(treesim->getSpeciesTree());
+    for(int i = 0; i < settings.numLoci; i++){
+        visitor.visitLocusTree(i, treesim->getLocusTree(i));
+        if(simType >= 3){
+            for(int j = 0; j < settings.numGenes; j++)
+                visitor.visitGeneTree(i, j, treesim->getGeneTree(i, j));
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Simulates one replicate and stores the Newick strings of its trees
+ *
+ * @param trees filled with the trees of the replicate, its old contents are replaced
+ * @return false if the settings are invalid
+ */
+bool TreeSimulation::simulate(SimTrees &trees){
+    if(!simulate())
+        return false;
+    trees.speciesTree = treesim->printSpeciesTreeNewick();
+    trees.extantSpeciesTree = (simType == 4) ? std::string() : treesim->printExtSpeciesTreeNewick();
+    trees.locusTrees.resize(settings.numLoci);
+    trees.geneTrees.resize(simType >= 3 ? settings.numLoci : 0);
+    trees.extantGeneTrees.resize(trees.geneTrees.size());
+    for(int i = 0; i < settings.numLoci; i++){
+        trees.locusTrees[i] = treesim->printLocusTreeNewick(i);
+        if(simType >= 3){
+            trees.geneTrees[i].resize(settings.numGenes);
+            trees.extantGeneTrees[i].resize(settings.numGenes);
+            for(int j = 0; j < settings.numGenes; j++){
+                trees.geneTrees[i][j] = treesim->printGeneTreeNewick(i, j);
+                trees.extantGeneTrees[i][j] = treesim->printExtantGeneTreeNewick(i, j);
+            }
+        }
+    }
+    return true;
+}
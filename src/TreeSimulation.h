@@ -0,0 +1,96 @@
+#ifndef TreeSimulation_h
+#define TreeSimulation_h
+
+#include "Simulator.h"
+#include "MbRandom.h"
+#include <string>
+#include <vector>
+
+/**
+ * @brief Settings of a TreeSimulation, by default a species tree of 100 taxa only
+ * @details Locus trees are simulated when numLoci is positive, and gene trees when indPerPop and popSize are too.
+ *          When speciesTree holds a Newick string the species tree is read from it instead of simulated, which needs gene
+ *          trees. A non-positive treeScale keeps simulated species trees in their own time units. samplingFraction is the
+ *          fraction of the extant species kept in the extant species tree of a simulated species tree, and must be 1 with a
+ *          given species tree.
+ */
+struct SimSettings{
+    int             numTaxa = 100;
+    double          spBirthRate = 0.5;
+    double          spDeathRate = 0.2;
+    double          geneBirthRate = 0.0;
+    double          geneDeathRate = 0.0;
+    double          transferRate = 0.0;
+    int             numLoci = 0;
+    int             numGenes = 0;
+    int             indPerPop = 0;
+    int             popSize = 0;
+    double          generationTime = 1.0;
+    double          outgroupFrac = 0.0;
+    double          treeScale = 1.0;
+    bool            sampleReconstructed = false;
+    double          samplingFraction = 1.0;
+    unsigned        dtwfSwitch = 0;
+    std::string     speciesTree;
+};
+
+/**
+ * @brief Newick strings of the trees of one replicate
+ * @details locusTrees has one tree per locus, geneTrees and extantGeneTrees one vector of numGenes trees per locus
+ *          when gene trees are simulated. extantSpeciesTree is empty when the species tree was given.
+ */
+struct SimTrees{
+    std::string                                 speciesTree;
+    std::string                                 extantSpeciesTree;
+    std::vector<std::string>                    locusTrees;
+    std::vector<std::vector<std::string> >      geneTrees;
+    std::vector<std::vector<std::string> >      extantGeneTrees;
+};
+
+/**
+ * @brief Receives the trees of a replicate as they are left in the simulator
+ * @details The trees are owned by the TreeSimulation and are only valid until it simulates the next replicate
+ */
+class SimVisitor{
+    public:
+        virtual                 ~SimVisitor() {}
+        virtual void            visitSpeciesTree(SpeciesTree *st) {}
+        virtual void            visitLocusTree(int locus, LocusTree *lt) {}
+        virtual void            visitGeneTree(int locus, int gene, GeneTree *gt) {}
+};
+
+/**
+ * @brief Simulates replicates of species, locus, and gene trees in process, without writing files
+ * @details The trees of the last replicate stay in the simulator and can be read with getSpeciesTree, getLocusTree,
+ *          and getGeneTree until the next call to simulate. Owns its random number generator and one Simulator reused by every replicate, so a long series of calls
+ *          (e.g. from an ABC sampler) does not allocate trees once the largest replicate has been simulated. Two
+ *          TreeSimulation objects share no state and can be run from different threads.
+ */
+class TreeSimulation{
+    private:
+        SimSettings             settings;
+        MbRandom                rando;
+        Simulator               *treesim;
+        SpeciesTree             *inputSpTree;
+        int                     simType;
+        std::string             errorMessage;
+
+    public:
+                                TreeSimulation(const SimSettings &s, seedType sd1, seedType sd2);
+                                ~TreeSimulation();
+                                TreeSimulation(const TreeSimulation&) = delete;
+        TreeSimulation&         operator=(const TreeSimulation&) = delete;
+        bool                    isValid() const { return treesim != nullptr; }
+        const std::string&      getErrorMessage() const { return errorMessage; }
+        MbRandom&               getRandom() { return rando; }
+        int                     getNumLoci() const { return settings.numLoci; }
+        int                     getNumGenes() const { return (simType >= 3) ? settings.numGenes : 0; }
+        SpeciesTree*            getSpeciesTree() { return treesim->getSpeciesTree(); }
+        LocusTree*              getLocusTree(int i) { return treesim->getLocusTree(i); }
+        GeneTree*               getGeneTree(int i, int j) { return treesim->getGeneTree(i, j); }
+        bool                    simulate();
+        bool                    simulate(SimVisitor &visitor);
+        bool                    simulate(SimTrees &trees);
+};
+
+#endif /* TreeSimulation_h */
@@ -0,0 +1,243 @@
+#include "TreeSimulationC.h"
+#include "TreeSimulation.h"
+#include <algorithm>
+#include <new>
+#include <utility>
+
+namespace {
+    /**
+     * @brief Flat arrays of one tree of the last replicate, kept between replicates so their memory is reused
+     */
+    struct TreeArrays{
+        bool                    filled = false;
+        std::vector<int32_t>    parent;
+        std::vector<double>     branchLength;
+        std::vector<int32_t>    label;
+        std::vector<int32_t>    nodeType;
+    };
+}
+
+struct td_simulation{
+    TreeSimulation                          sim;
+    bool                                    simulated;
+    std::vector<TreeArrays>                 trees;
+    std::vector<std::pair<Node*, int32_t> > stack;
+
+    td_simulation(const SimSettings &s, seedType sd1, seedType sd2) : sim(s, sd1, sd2), simulated(false) {}
+};
+
+namespace {
+    /**
+     * @brief Finds a tree of the last replicate and the slot of its arrays
+     *
+     * @return Tree* or nullptr if there is no such tree
+     */
+    Tree* findTree(td_simulation *sim, td_tree_kind kind, int locus, int gene, size_t &slot){
+        if(sim == nullptr || !sim->simulated)
+            return nullptr;
+        int nl = sim->sim.getNumLoci();
+        int ng = sim->sim.getNumGenes();
+        switch(kind){
+            case TD_SPECIES_TREE:
+                slot = 0;
+                return sim->sim.getSpeciesTree();
+            case TD_LOCUS_TREE:
+                if(locus < 0 || locus >= nl)
+                    return nullptr;
+                slot = 1 + (size_t) locus;
+                return sim->sim.getLocusTree(locus);
+            case TD_GENE_TREE:
+                if(locus < 0 || locus >= nl || gene < 0 || gene >= ng)
+                    return nullptr;
+                slot = 1 + (size_t) nl + (size_t) locus * ng + gene;
+                return sim->sim.getGeneTree(locus, gene);
+        }
+        return nullptr;
+    }
+
+    /**
+     * @brief Fills the arrays of a tree in preorder from its root, with an explicit stack so deep trees are safe
+     */
+    void fillArrays(Tree *t, TreeArrays &a, std::vector<std::pair<Node*, int32_t> > &stack){
+        a.parent.clear();
+        a.branchLength.clear();
+        a.label.clear();
+        a.nodeType.clear();
+        stack.clear();
+        if(t->getRoot() != nullptr)
+            stack.emplace_back(t->getRoot(), -1);
+        while(!stack.empty()){
+            Node *p = stack.back().first;
+            int32_t anc = stack.back().second;
+            stack.pop_back();
+            auto pos = (int32_t) a.parent.size();
+            a.parent.push_back(anc);
+            a.branchLength.push_back(p->getBranchLength());
+            a.label.push_back(p->getIndex());
+            if(p->getLdes() == nullptr && p->getRdes() == nullptr)
+                a.nodeType.push_back(p->getIsExtinct() ? TD_NODE_EXTINCT_TIP : TD_NODE_EXTANT_TIP);
+            else
+                a.nodeType.push_back(p->getIsDuplication() ? TD_NODE_DUPLICATION : TD_NODE_INTERNAL);
+            if(p->getRdes() != nullptr)
+                stack.emplace_back(p->getRdes(), pos);
+            if(p->getLdes() != nullptr)
+                stack.emplace_back(p->getLdes(), pos);
+        }
+        a.filled = true;
+    }
+
+    /**
+     * @brief Arrays of a tree of the last replicate, filled on first use
+     *
+     * @return TreeArrays* or nullptr if there is no such tree
+     */
+    TreeArrays* getArrays(td_simulation *sim, td_tree_kind kind, int locus, int gene){
+        size_t slot = 0;
+        Tree *t = findTree(sim, kind, locus, gene, slot);
+        if(t == nullptr)
+            return nullptr;
+        if(slot >= sim->trees.size())
+            sim->trees.resize(slot + 1);
+        TreeArrays &a = sim->trees[slot];
+        if(!a.filled)
+            fillArrays(t, a, sim->stack);
+        return &a;
+    }
+}
+
+void td_default_settings(td_settings *s){
+    SimSettings d;
+    s->numTaxa = d.numTaxa;
+    s->spBirthRate = d.spBirthRate;
+    s->spDeathRate = d.spDeathRate;
+    s->geneBirthRate = d.geneBirthRate;
+    s->geneDeathRate = d.geneDeathRate;
+    s->transferRate = d.transferRate;
+    s->numLoci = d.numLoci;
+    s->numGenes = d.numGenes;
+    s->indPerPop = d.indPerPop;
+    s->popSize = d.popSize;
+    s->generationTime = d.generationTime;
+    s->outgroupFrac = d.outgroupFrac;
+    s->treeScale = d.treeScale;
+    s->sampleReconstructed = d.sampleReconstructed;
+    s->samplingFraction = d.samplingFraction;
+    s->dtwfSwitch = d.dtwfSwitch;
+    s->speciesTree = nullptr;
+}
+
+td_simulation* td_create(const td_settings *s, unsigned seed1, unsigned seed2){
+    SimSettings settings;
+    if(s != nullptr){
+        settings.numTaxa = s->numTaxa;
+        settings.spBirthRate = s->spBirthRate;
+        settings.spDeathRate = s->spDeathRate;
+        settings.geneBirthRate = s->geneBirthRate;
+        settings.geneDeathRate = s->geneDeathRate;
+        settings.transferRate = s->transferRate;
+        settings.numLoci = s->numLoci;
+        settings.numGenes = s->numGenes;
+        settings.indPerPop = s->indPerPop;
+        settings.popSize = s->popSize;
+        settings.generationTime = s->generationTime;
+        settings.outgroupFrac = s->outgroupFrac;
+        settings.treeScale = s->treeScale;
+        settings.sampleReconstructed = s->sampleReconstructed != 0;
+        settings.samplingFraction = s->samplingFraction;
+        settings.dtwfSwitch = s->dtwfSwitch;
+        if(s->speciesTree != nullptr)
+            settings.speciesTree = s->speciesTree;
+    }
+    try{
+        return new td_simulation(settings, seed1, seed2);
+    }
+    catch(...){
+        return nullptr;
+    }
+}
+
+void td_destroy(td_simulation *sim){
+    delete sim;
+}
+
+const char* td_error(const td_simulation *sim){
+    if(sim == nullptr)
+        return "No simulation.";
+    return sim->sim.isValid() ? nullptr : sim->sim.getErrorMessage().c_str();
+}
+
+int td_num_loci(const td_simulation *sim){
+    return (sim != nullptr) ? sim->sim.getNumLoci() : 0;
+}
+
+int td_num_genes(const td_simulation *sim){
+    return (sim != nullptr) ? sim->sim.getNumGenes() : 0;
+}
+
+int td_simulate(td_simulation *sim){
+    if(sim == nullptr || !sim->sim.isValid())
+        return -1;
+    try{
+        sim->simulated = false;
+        for(auto & a : sim->trees)
+            a.filled = false;
+        if(!sim->sim.simulate())
+            return -1;
+        sim->simulated = true;
+        return 0;
+    }
+    catch(...){
+        return -1;
+    }
+}
+
+int32_t td_tree_num_nodes(td_simulation *sim, td_tree_kind kind, int locus, int gene){
+    try{
+        TreeArrays *a = getArrays(sim, kind, locus, gene);
+        return (a != nullptr) ? (int32_t) a->parent.size() : -1;
+    }
+    catch(...){
+        return -1;
+    }
+}
+
+int td_view_tree(td_simulation *sim, td_tree_kind kind, int locus, int gene, td_tree *tree){
+    try{
+        TreeArrays *a = getArrays(sim, kind, locus, gene);
+        if(a == nullptr || tree == nullptr)
+            return -1;
+        tree->num_nodes = (int32_t) a->parent.size();
+        tree->parent = a->parent.data();
+        tree->branch_length = a->branchLength.data();
+        tree->label = a->label.data();
+        tree->node_type = a->nodeType.data();
+        return 0;
+    }
+    catch(...){
+        return -1;
+    }
+}
+
+int32_t td_export_tree(td_simulation *sim, td_tree_kind kind, int locus, int gene, int32_t capacity,
+                       int32_t *parent, double *branch_length, int32_t *label, int32_t *node_type){
+    try{
+        TreeArrays *a = getArrays(sim, kind, locus, gene);
+        if(a == nullptr)
+            return -1;
+        auto n = (int32_t) a->parent.size();
+        if(n > capacity)
+            return n;
+        if(parent != nullptr)
+            std::copy(a->parent.begin(), a->parent.end(), parent);
+        if(branch_length != nullptr)
+            std::copy(a->branchLength.begin(), a->branchLength.end(), branch_length);
+        if(label != nullptr)
+            std::copy(a->label.begin(), a->label.end(), label);
+        if(node_type != nullptr)
+            std::copy(a->nodeType.begin(), a->nodeType.end(), node_type);
+        return n;
+    }
+    catch(...){
+        return -1;
+    }
+}
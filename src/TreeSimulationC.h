@@ -0,0 +1,102 @@
+#ifndef TreeSimulationC_h
+#define TreeSimulationC_h
+
+/*
+ * C interface of the treeducken library, for drivers in languages that can call C but not C++.
+ *
+ * Trees are exported as flat arrays with one entry per node, parents before their children, so they can be wrapped
+ * as arrays by the host language without parsing Newick strings:
+ *   parent         position of the parent node in the arrays, -1 for the root
+ *   branch_length  length of the branch above the node
+ *   label          index of the node in its tree; for tips this is the number in the Newick tip name
+ *                  (T4 or X4 in species trees, T4_1 in locus trees, 4_1 in gene trees)
+ *   node_type      one of the td_node_type values
+ *
+ * td_view_tree returns arrays owned by the simulation, filled on the first view of a tree and valid until the next
+ * td_simulate or td_destroy. td_export_tree copies the same values into arrays provided by the caller.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct td_simulation td_simulation;
+
+typedef enum {
+    TD_SPECIES_TREE = 0,
+    TD_LOCUS_TREE = 1,
+    TD_GENE_TREE = 2
+} td_tree_kind;
+
+typedef enum {
+    TD_NODE_INTERNAL = 0,
+    TD_NODE_EXTANT_TIP = 1,
+    TD_NODE_EXTINCT_TIP = 2,
+    TD_NODE_DUPLICATION = 3
+} td_node_type;
+
+/* same parameters as SimSettings in TreeSimulation.h, species_tree is a Newick string or NULL */
+typedef struct {
+    int             numTaxa;
+    double          spBirthRate;
+    double          spDeathRate;
+    double          geneBirthRate;
+    double          geneDeathRate;
+    double          transferRate;
+    int             numLoci;
+    int             numGenes;
+    int             indPerPop;
+    int             popSize;
+    double          generationTime;
+    double          outgroupFrac;
+    double          treeScale;
+    int             sampleReconstructed;
+    double          samplingFraction;
+    unsigned        dtwfSwitch;
+    const char      *speciesTree;
+} td_settings;
+
+typedef struct {
+    int32_t         num_nodes;
+    const int32_t   *parent;
+    const double    *branch_length;
+    const int32_t   *label;
+    const int32_t   *node_type;
+} td_tree;
+
+/* fills s with the defaults of SimSettings */
+void            td_default_settings(td_settings *s);
+
+/* returns NULL only if memory runs out, check td_error before simulating */
+td_simulation*  td_create(const td_settings *s, unsigned seed1, unsigned seed2);
+void            td_destroy(td_simulation *sim);
+
+/* NULL if the settings are valid, otherwise why they are not */
+const char*     td_error(const td_simulation *sim);
+
+int             td_num_loci(const td_simulation *sim);
+int             td_num_genes(const td_simulation *sim);
+
+/* simulates one replicate, returns 0 on success */
+int             td_simulate(td_simulation *sim);
+
+/* number of nodes of a tree of the last replicate, -1 if there is no such tree; locus and gene are ignored
+   when they do not apply */
+int32_t         td_tree_num_nodes(td_simulation *sim, td_tree_kind kind, int locus, int gene);
+
+/* returns 0 on success, -1 if there is no such tree */
+int             td_view_tree(td_simulation *sim, td_tree_kind kind, int locus, int gene, td_tree *tree);
+
+/* copies a tree into arrays of at least capacity entries, any of which may be NULL to skip it. Returns the number of
+   nodes of the tree, which is larger than capacity if nothing was copied, or -1 if there is no such tree */
+int32_t         td_export_tree(td_simulation *sim, td_tree_kind kind, int locus, int gene, int32_t capacity,
+                               int32_t *parent, double *branch_length, int32_t *label, int32_t *node_type);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TreeSimulationC_h */
@@ -0,0 +1,171 @@
+#include "TreeStatistics.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <sstream>
+
+/**
+ * @brief Constructor of the TreeStatistics class, all statistics start at zero
+ */
+TreeStatistics::TreeStatistics(){
+    colless = 0.0;
+    sackin = 0.0;
+    gamma = 0.0;
+    numCherries = 0;
+    numTips = 0;
+}
+
+/**
+ * @brief Steps from a node to the next node that is part of the tree being summarised
+ *
+ * @param p node to start from
+ * @param extantOnly true if only the extant tree is summarised
+ * @return Node* the next node in the view
+ * @see Tree::nextNodeInExtantView()
+ */
+Node* TreeStatistics::nextNodeInView(Node *p, bool extantOnly){
+    double brlen;
+    if(extantOnly)
+        return Tree::nextNodeInExtantView(p, brlen);
+    return p;
+}
+
+/**
+ * @brief Calculates the Colless and Sackin indices, the number of cherries, the branching times and gamma of a tree
+ * @details Uses an explicit stack for the postorder traversal so that very unbalanced trees do not run out of call stack.
+ *          Each internal node pushes the number of tips below it onto a second stack which is read by its ancestor.
+ *
+ * @param t tree to summarise
+ * @param extantOnly true if lineages without extant descendants should be skipped
+ */
+void TreeStatistics::calcStatistics(Tree *t, bool extantOnly){
+    colless = 0.0;
+    sackin = 0.0;
+    gamma = 0.0;
+    numCherries = 0;
+    numTips = 0;
+    branchingTimes.clear();
+    if(t->getRoot() == nullptr)
+        return;
+    if(extantOnly && t->setExtantView() == nullptr)
+        return;
+
+    std::vector<std::pair<Node*, int> > nodeStack;
+    std::vector<unsigned> tipCounts;
+    double presentTime = 0.0;
+    unsigned nl, nr;
+
+    nodeStack.emplace_back(nextNodeInView(t->getRoot(), extantOnly), 0);
+    while(!nodeStack.empty()){
+        Node *p = nodeStack.back().first;
+        int &state = nodeStack.back().second;
+        if(p->getRdes() == nullptr){
+            if(numTips == 0 || p->getDeathTime() > presentTime)
+                presentTime = p->getDeathTime();
+            numTips++;
+            tipCounts.push_back(1);
+            nodeStack.pop_back();
+        }
+        else if(state == 0){
+            state = 1;
+            nodeStack.emplace_back(nextNodeInView(p->getLdes(), extantOnly), 0);
+        }
+        else if(state == 1){
+            state = 2;
+            nodeStack.emplace_back(nextNodeInView(p->getRdes(), extantOnly), 0);
+        }
+        else{
+            nr = tipCounts.back();
+            tipCounts.pop_back();
+            nl = tipCounts.back();
+            tipCounts.pop_back();
+            colless += (nl > nr) ? nl - nr : nr - nl;
+            sackin += nl + nr;
+            if(nl == 1 && nr == 1)
+                numCherries++;
+            branchingTimes.push_back(p->getDeathTime());
+            tipCounts.push_back(nl + nr);
+            nodeStack.pop_back();
+        }
+    }
+    calcGamma(presentTime);
+}
+
+/**
+ * @brief Calculates the gamma statistic of Pybus and Harvey (2000) and converts the branching times to node ages
+ * @details On entry branchingTimes holds the times of the internal nodes measured from the start of the simulation.
+ *          These are sorted from oldest to youngest and turned into ages before the present.
+ *
+ * @param presentTime time of the tips of the tree
+ */
+void TreeStatistics::calcGamma(double presentTime){
+    std::sort(branchingTimes.begin(), branchingTimes.end());
+    unsigned n = numTips;
+    if(n > 2 && branchingTimes.size() == n - 1){
+        // g_k is the internode interval with k lineages
+        double T = 0.0;
+        double sumPartialT = 0.0;
+        double interval;
+        for(unsigned k = 2; k <= n; k++){
+            if(k < n)
+                interval = branchingTimes[k - 1] - branchingTimes[k - 2];
+            else
+                interval = presentTime - branchingTimes[k - 2];
+            T += k * interval;
+            if(k < n)
+                sumPartialT += T;
+        }
+        if(T > 0.0)
+            gamma = ((sumPartialT / (n - 2.0)) - (T / 2.0)) / (T * std::sqrt(1.0 / (12.0 * (n - 2.0))));
+    }
+    for(auto & bt : branchingTimes)
+        bt = presentTime - bt;
+}
+
+/**
+ * @brief Writes the branching times as a comma separated list
+ * @return std::string of the branching times from oldest to youngest
+ */
+std::string TreeStatistics::printBranchingTimes(){
+    std::stringstream ss;
+    for(auto it = branchingTimes.begin(); it != branchingTimes.end(); ++it){
+        if(it != branchingTimes.begin())
+            ss << ",";
+        ss << *it;
+    }
+    return ss.str();
+}
+
+/**
+ * @brief Parses a comma separated list of statistics names (e.g. "colless,gamma" or "all")
+ *
+ * @param sel string passed in with -stats
+ * @return int with the bits of the selected statistics set, -1 if a name is not recognized
+ */
+int TreeStatistics::parseSelector(const std::string &sel){
+    int statsSel = 0;
+    std::stringstream ss(sel);
+    std::string name;
+    while(std::getline(ss, name, ',')){
+        name.erase(std::remove_if(name.begin(), name.end(), ::isspace), name.end());
+        if(name.empty() || name == "none")
+            continue;
+        else if(name == "colless")
+            statsSel |= Stat_Colless;
+        else if(name == "sackin")
+            statsSel |= Stat_Sackin;
+        else if(name == "gamma")
+            statsSel |= Stat_Gamma;
+        else if(name == "cherries")
+            statsSel |= Stat_Cherries;
+        else if(name == "btimes")
+            statsSel |= Stat_BranchingTimes;
+        else if(name == "discord")
+            statsSel |= Stat_Discordance;
+        else if(name == "all")
+            statsSel |= Stat_All;
+        else
+            return -1;
+    }
+    return statsSel;
+}
@@ -0,0 +1,46 @@
+#ifndef TreeStatistics_h
+#define TreeStatistics_h
+
+#include "Tree.h"
+#include <string>
+#include <vector>
+
+/**
+ * @brief Shape and balance statistics of a tree (Colless, Sackin, Pybus-Harvey gamma, cherries)
+ * @details All statistics are gathered in a single postorder pass over the tree. When only the extant tree is
+ *          requested the pass follows the flags set by Tree::setExtantView and steps over lineages without
+ *          extant descendants, so the pruned tree never has to be rebuilt.
+ */
+class TreeStatistics{
+    private:
+        double              colless, sackin, gamma;
+        unsigned            numCherries, numTips;
+        std::vector<double> branchingTimes;
+
+        static Node*        nextNodeInView(Node *p, bool extantOnly);
+        void                calcGamma(double presentTime);
+
+    public:
+        enum {
+            Stat_Colless        = 0x01,     // Colless index
+            Stat_Sackin         = 0x02,     // Sackin index
+            Stat_Gamma          = 0x04,     // Pybus-Harvey gamma
+            Stat_Cherries       = 0x08,     // number of cherries
+            Stat_BranchingTimes = 0x10,     // node ages of the tree
+            Stat_Discordance    = 0x20,     // gene tree discordance with the species tree
+            Stat_All            = 0x3F
+        };
+
+                            TreeStatistics();
+        void                calcStatistics(Tree *t, bool extantOnly);
+        double              getColless() { return colless; }
+        double              getSackin() { return sackin; }
+        double              getGamma() { return gamma; }
+        unsigned            getNumCherries() { return numCherries; }
+        unsigned            getNumTips() { return numTips; }
+        std::vector<double> getBranchingTimes() { return branchingTimes; }
+        std::string         printBranchingTimes();
+        static int          parseSelector(const std::string &sel);
+};
+
+#endif /* TreeStatistics_h */
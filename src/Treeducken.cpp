@@ -2,6 +2,7 @@
 #include "SpeciesTree.h"
 #include "Simulator.h"
 #include "Engine.h"
+#include "SimServer.h"
 #include <string.h>
 
 #include "GitVersion.h"
@@ -22,22 +23,47 @@ void printHelp(){
     std::cout << "\t\t-sd2  : seed 2 \n";
     std::cout << "\t\t-sbr  : species birth rate [= 0.5]\n";
     std::cout << "\t\t-sdr  : species death rate [= 0.2]\n";
+    std::cout << "\t\t-sbrshift : species birth rate shifts t1:r1,t2:r2,... with the rate r1 from time t1 on, \n";
+    std::cout << "\t\t            times forward from the origin of the tree before -sc [= ""]\n";
+    std::cout << "\t\t-sdrshift : species death rate shifts, as for -sbrshift [= ""]\n";
+    std::cout << "\t\t-sbrexp   : species birth rate changes as sbr * exp(a * t) with this a [= 0.0]\n";
+    std::cout << "\t\t-sdrexp   : species death rate changes as sdr * exp(a * t) with this a [= 0.0]\n";
+    std::cout << "\t\t-rho  : fraction of the extant species sampled in the extant species tree, the others are \n";
+    std::cout << "\t\t        pruned from it and its statistics [= 1.0]\n";
     std::cout << "\t\t-gbr  : gene birth rate [= 0.0]\n";
     std::cout << "\t\t-gdr  : gene death rate [= 0.0]\n";
     std::cout << "\t\t-lgtr : gene transfer rate [= 0.0]\n";
     std::cout << "\t\t-ipp  : individuals to sample per locus [= 0]\n";
     std::cout << "\t\t-ne   : effective population size per locus [= 0] \n";
     std::cout << "\t\t-ng   : number of genes to simulate per locus [= 0] \n";
+    std::cout << "\t\t-dtwf : simulate gene trees by Wright-Fisher generations until this many lineages are left, \n";
+    std::cout << "\t\t        then by the coalescent, 0 for the coalescent only (allows ipp > ne) [= 0] \n";
     std::cout << "\t\t-og   : fraction of tree to use as length of branch between outgroup [=0.0] \n" ;
+    std::cout << "\t\t-rec    : sample the species tree of extant species directly, without extinct lineages [=0] \n";
     std::cout << "\t\t-istnw  : input species tree (newick format) [=""] \n";
+    std::cout << "\t\t-istf   : file of input species trees (NEXUS or newick format) [=""] \n";
+    std::cout << "\t\t-sweep  : table of settings to run, one row per run, columns named by flag \n";
+    std::cout << "\t\t          (sbr, sdr, gbr, gdr, lgtr, ipp, ne, nt, r, nl, ng, og, sc, dtwf, rho) [=""] \n";
+    std::cout << "\t\t-nth    : number of threads used with -istf, -sweep, or -serve [=1] \n";
+    std::cout << "\t\t-serve  : run as a server taking jobs on this Unix domain socket, one line of flags per job \n";
+    std::cout << "\t\t          (see SimServer.h), until a client sends shutdown [=""] \n";
     std::cout << "\t\t-sc     : tree scale [=1.0] \n";
-    std::cout << "\t\t-sout   : turn off standard output (improves runtime) \n";
+    std::cout << "\t\t-sout   : turn off the progress report on standard error and the summary \n";
+    std::cout << "\t\t-stats  : tree shape statistics to write to the stats file, comma separated \n";
+    std::cout << "\t\t          (colless, sackin, gamma, cherries, btimes, discord, all) [=none] \n";
+    std::cout << "\t\t-prof   : write the time spent in each phase and the events simulated to <prefix>.profile.json [=0] \n";
+    std::cout << "\t\t-trace  : write a timeline of the replicates of each thread to <prefix>.trace.json, \n";
+    std::cout << "\t\t          viewable in Perfetto or chrome://tracing [=0] \n";
+    std::cout << "\t\t-ckpt   : save the state of the run to <prefix>.checkpoint every this many replicates [=0] \n";
+    std::cout << "\t\t-resume : continue a run from <prefix>.checkpoint, with the settings of the original run [=0] \n";
+    std::cout << "\t\t-max-nodes : abort replicates whose trees need more than this many nodes, 0 for no limit [=0] \n";
+    std::cout << "\t\t-max-mem   : abort replicates whose tree nodes need more than this many megabytes, 0 for no limit [=0] \n";
 //    std::cout << "\t\t-mst    : Moran species tree ";
 }
 
 void printSettings(const std::string& of, int nt, int r, int nloc, int ts, double sbr, double sdr,
                    double gbr, double gdr, double lgtr, int ipp, int ne, int ngen, double og,
-                   const std::string& stn, bool mst){
+                   const std::string& stn, const std::string& stf, bool mst){
     std::cout << "\t\toutput file name prefix         = " << of << "\n";
     std::cout << "\t\tNumber of extant taxa           = " << nt << "\n";
     std::cout << "\t\tNumber of replicates            = " << r << "\n";
@@ -52,6 +78,7 @@ void printSettings(const std::string& of, int nt, int r, int nloc, int ts, doubl
     std::cout << "\t\tEffective pop size per locus    = " << ne << "\n";
     std::cout << "\t\tTree fraction to set outgroup   = " << og << "\n";
     std::cout << "\t\tSpecies tree input as newick    = " << stn << "\n";
+    std::cout << "\t\tSpecies tree file               = " << stf << "\n";
     std::cout << "\t\tTree scale                      = " << ts  << "\n";
 // std::cout << "\t\tMoran process species tree      = " << mst << "\n";
 }
@@ -75,10 +102,24 @@ int main(int argc, char * argv[]) {
     else{
         std::string outName;
         std::string stn;
-        int nt = 100, r = 10, nloc = 10, ipp = 0, ne = 0, sd1 = 0, sd2 = 0, ngen = 0;
+        std::string stf;
+        std::string swf;
+        std::string servePath;
+        int nth = 1;
+        bool rec = false;
+        bool prof = false;
+        bool trace = false;
+        bool resume = false;
+        int ckpt = 0;
+        double maxNodes = 0.0, maxMem = 0.0;
+        std::string sbrShift, sdrShift;
+        double sbrExp = 0.0, sdrExp = 0.0;
+        double rho = 1.0;
+        int nt = 100, r = 10, nloc = 10, ipp = 0, ne = 0, sd1 = 0, sd2 = 0, ngen = 0, dtwf = 0;
         double sbr = 0.5, sdr = 0.2, gbr = 0.0, gdr = 0.0, lgtr = 0.0, ts = 1.0, og = 0.0;
         bool sout = true;
         bool mst = false;
+        std::string statsSelStr;
         for (int i = 0; i < argc; i++){
                 char *curArg = argv[i];
                 if(strlen(curArg) > 1 && curArg[0] == '-'){
@@ -90,7 +131,15 @@ int main(int argc, char * argv[]) {
                         if(settings.is_open()){
                             while( getline (settings, line) ){
                                 if(line.substr(0,1) != comment){
-                                    if(line.substr(0,4) == "-sbr")
+                                    if(line.substr(0,9) == "-sbrshift")
+                                        sbrShift = line.substr(10, std::string::npos - 1);
+                                    else if(line.substr(0,9) == "-sdrshift")
+                                        sdrShift = line.substr(10, std::string::npos - 1);
+                                    else if(line.substr(0,7) == "-sbrexp")
+                                        sbrExp = atof(line.substr(8, std::string::npos - 1).c_str());
+                                    else if(line.substr(0,7) == "-sdrexp")
+                                        sdrExp = atof(line.substr(8, std::string::npos - 1).c_str());
+                                    else if(line.substr(0,4) == "-sbr")
                                         sbr = atof(line.substr(5, std::string::npos - 1).c_str());
                                     else if(line.substr(0,4) == "-sdr")
                                         sdr = atof(line.substr(5, std::string::npos - 1).c_str());
@@ -102,8 +151,12 @@ int main(int argc, char * argv[]) {
                                         lgtr = atof(line.substr(6, std::string::npos - 1).c_str());
                                     else if(line.substr(0,3) == "-ne")
                                         ne = atof(line.substr(4, std::string::npos - 1).c_str());
+                                    else if(line.substr(0,5) == "-dtwf")
+                                        dtwf = atoi(line.substr(6, std::string::npos - 1).c_str());
                                     else if(line.substr(0,4) == "-ipp")
                                         ipp = atof(line.substr(5, std::string::npos - 1).c_str());
+                                    else if(line.substr(0,4) == "-nth")
+                                        nth = atoi(line.substr(5, std::string::npos - 1).c_str());
                                     else if(line.substr(0,3) == "-nt")
                                         nt = atoi(line.substr(4, std::string::npos - 1).c_str());
                                     else if(line.substr(0,3) == "-sc")
@@ -112,6 +165,24 @@ int main(int argc, char * argv[]) {
                                         nloc = atoi(line.substr(4, std::string::npos - 1).c_str());
                                     else if(line.substr(0,3) == "-og")
                                         og = atof(line.substr(4, std::string::npos - 1).c_str());
+                                    else if(line.substr(0,5) == "-prof")
+                                        prof = atoi(line.substr(6, std::string::npos - 1).c_str());
+                                    else if(line.substr(0,6) == "-trace")
+                                        trace = atoi(line.substr(7, std::string::npos - 1).c_str());
+                                    else if(line.substr(0,6) == "-serve")
+                                        servePath = line.substr(7, std::string::npos - 1);
+                                    else if(line.substr(0,5) == "-ckpt")
+                                        ckpt = atoi(line.substr(6, std::string::npos - 1).c_str());
+                                    else if(line.substr(0,7) == "-resume")
+                                        resume = atoi(line.substr(8, std::string::npos - 1).c_str());
+                                    else if(line.substr(0,10) == "-max-nodes")
+                                        maxNodes = atof(line.substr(11, std::string::npos - 1).c_str());
+                                    else if(line.substr(0,8) == "-max-mem")
+                                        maxMem = atof(line.substr(9, std::string::npos - 1).c_str());
+                                    else if(line.substr(0,4) == "-rho")
+                                        rho = atof(line.substr(5, std::string::npos - 1).c_str());
+                                    else if(line.substr(0,4) == "-rec")
+                                        rec = atoi(line.substr(5, std::string::npos - 1).c_str());
                                     else if(line.substr(0,2) == "-r")
                                         r = atoi(line.substr(3, std::string::npos - 1).c_str());
                                     else if(line.substr(0,2) == "-o")
@@ -124,10 +195,16 @@ int main(int argc, char * argv[]) {
                                         ngen = atoi(line.substr(4, std::string::npos-1).c_str());
                                     else if(line.substr(0,6) == "-istnw")
                                         stn = line.substr(7, std::string::npos-1).c_str();
+                                    else if(line.substr(0,5) == "-istf")
+                                        stf = line.substr(6, std::string::npos-1).c_str();
+                                    else if(line.substr(0,6) == "-sweep")
+                                        swf = line.substr(7, std::string::npos-1).c_str();
                                     else if(line.substr(0,5) == "-sout")
                                         sout = atoi(line.substr(6, std::string::npos-1).c_str());
                                     else if(line.substr(0,4) == "-mst")
                                         mst = atoi(line.substr(5, std::string::npos-1).c_str());
+                                    else if(line.substr(0,6) == "-stats")
+                                        statsSelStr = line.substr(7, std::string::npos-1).c_str();
                                 }
                             }
 
@@ -139,6 +216,14 @@ int main(int argc, char * argv[]) {
                     }
                     else if(!strcmp(curArg, "-sbr"))
                         sbr = atof(argv[i+1]);
+                    else if(!strcmp(curArg, "-sbrshift"))
+                        sbrShift = argv[i+1];
+                    else if(!strcmp(curArg, "-sdrshift"))
+                        sdrShift = argv[i+1];
+                    else if(!strcmp(curArg, "-sbrexp"))
+                        sbrExp = atof(argv[i+1]);
+                    else if(!strcmp(curArg, "-sdrexp"))
+                        sdrExp = atof(argv[i+1]);
                     else if(!strcmp(curArg, "-sdr"))
                         sdr = atof(argv[i+1]);
                     else if(!strcmp(curArg, "-gbr"))
@@ -149,6 +234,8 @@ int main(int argc, char * argv[]) {
                         lgtr = atof(argv[i+1]);
                     else if(!strcmp(curArg, "-ne"))
                         ne = atof(argv[i+1]);
+                    else if(!strcmp(curArg, "-dtwf"))
+                        dtwf = atoi(argv[i+1]);
                     else if(!strcmp(curArg, "-ipp"))
                         ipp = atof(argv[i+1]);
                     else if(!strcmp(curArg, "-nt"))
@@ -165,12 +252,38 @@ int main(int argc, char * argv[]) {
                         outName = argv[i+1];
                     else if(!strcmp(curArg, "-istnw"))
                         stn = argv[i+1];
+                    else if(!strcmp(curArg, "-istf"))
+                        stf = argv[i+1];
+                    else if(!strcmp(curArg, "-prof"))
+                        prof = atoi(argv[i+1]);
+                    else if(!strcmp(curArg, "-trace"))
+                        trace = atoi(argv[i+1]);
+                    else if(!strcmp(curArg, "-serve"))
+                        servePath = argv[i+1];
+                    else if(!strcmp(curArg, "-ckpt"))
+                        ckpt = atoi(argv[i+1]);
+                    else if(!strcmp(curArg, "-resume"))
+                        resume = atoi(argv[i+1]);
+                    else if(!strcmp(curArg, "-max-nodes"))
+                        maxNodes = atof(argv[i+1]);
+                    else if(!strcmp(curArg, "-max-mem"))
+                        maxMem = atof(argv[i+1]);
+                    else if(!strcmp(curArg, "-rec"))
+                        rec = atoi(argv[i+1]);
+                    else if(!strcmp(curArg, "-rho"))
+                        rho = atof(argv[i+1]);
+                    else if(!strcmp(curArg, "-sweep"))
+                        swf = argv[i+1];
+                    else if(!strcmp(curArg, "-nth"))
+                        nth = atoi(argv[i+1]);
                     else if(!strcmp(curArg, "-og"))
                         og = atof(argv[i+1]);
                     else if(!strcmp(curArg, "-sout"))
                         sout = atoi(argv[i+1]);
                     else if(!strcmp(curArg, "-mst"))
                         mst = atoi(argv[i+1]);
+                    else if(!strcmp(curArg, "-stats"))
+                        statsSelStr = argv[i+1];
                     else if(!strcmp(curArg, "-h")){
                         printHelp();
                         return 0;
@@ -188,7 +301,48 @@ int main(int argc, char * argv[]) {
                     }
                 }
         }
-        if(!stn.empty()){
+        if(!servePath.empty()){
+            SimServer server(servePath, nth > 0 ? (unsigned) nth : 1, (seedType) sd1, (seedType) sd2);
+            return server.run() ? 0 : 1;
+        }
+        int statsSel = TreeStatistics::parseSelector(statsSelStr);
+        if(statsSel < 0){
+            std::cerr << "Unrecognized tree statistic in -stats " << statsSelStr << ", exiting...\n";
+            printHelp();
+            exit(1);
+        }
+        RateChanges birthChanges, deathChanges;
+        std::string rateErr;
+        if((!sbrShift.empty() && !birthChanges.parseShifts(sbrShift, rateErr)) ||
+           (!sdrShift.empty() && !deathChanges.parseShifts(sdrShift, rateErr))){
+            std::cerr << "Invalid rate shifts, " << rateErr << ", exiting...\n";
+            exit(1);
+        }
+        if((!sbrShift.empty() && sbrExp != 0.0) || (!sdrShift.empty() && sdrExp != 0.0)){
+            std::cerr << "Use only one of -sbrshift and -sbrexp, and of -sdrshift and -sdrexp, exiting...\n";
+            exit(1);
+        }
+        birthChanges.exponent = sbrExp;
+        deathChanges.exponent = sdrExp;
+        if(rec && !(birthChanges.isConstant() && deathChanges.isConstant()))
+            std::cerr << "-rec needs constant rates, the species trees will be simulated with the GSA.\n";
+        if(rho <= 0.0 || rho > 1.0){
+            std::cerr << "The sampling fraction -rho must be in (0, 1], exiting...\n";
+            exit(1);
+        }
+        if(!stn.empty() && !stf.empty()){
+            std::cerr << "Use only one of -istnw and -istf, exiting...\n";
+            exit(1);
+        }
+        if(!swf.empty() && (!stn.empty() || !stf.empty())){
+            std::cerr << "-sweep can not be used with an input species tree, exiting...\n";
+            exit(1);
+        }
+        if(rho < 1.0 && (!stn.empty() || !stf.empty())){
+            std::cerr << "-rho only samples simulated species trees, it can not be used with an input species tree, exiting...\n";
+            exit(1);
+        }
+        if(!stn.empty() || !stf.empty()){
             mt = 4;
             std::cout << "Species tree is set. Simulating only locus and gene trees...\n";
             if(nloc > 0){
@@ -200,30 +354,30 @@ int main(int argc, char * argv[]) {
                         exit(1);
                     }
                     else{
-                        if(ne >  0 && ipp > 0 && ipp <= ne){
+                        if(ne >  0 && ipp > 0 && (ipp <= ne || dtwf > 0)){
                             std::cout << "Gene birth rate is 0.0.\n";
                         }
                         else{
                             std::cerr << "Gene tree parameters are incorrectly specified. Only simulating species and locus trees\n";
-                            std::cerr << "Population size and individuals per population must both be positive integers and individuals per population must be less than or equal to the population size.\n";
-                            printSettings(outName, nt, r, nloc, ts, sbr, sdr, gbr, gdr, lgtr, ipp, ne, ngen, og, stn, mst);
+                            std::cerr << "Population size and individuals per population must both be positive integers and individuals per population must be less than or equal to the population size unless -dtwf is set.\n";
+                            printSettings(outName, nt, r, nloc, ts, sbr, sdr, gbr, gdr, lgtr, ipp, ne, ngen, og, stn, stf, mst);
                             printHelp();
                             exit(1);
                         }
                     }
-                    printSettings(outName, nt, r, nloc, ts, sbr, sdr, gbr, gdr, lgtr, ipp, ne, ngen, og, stn, mst);
+                    printSettings(outName, nt, r, nloc, ts, sbr, sdr, gbr, gdr, lgtr, ipp, ne, ngen, og, stn, stf, mst);
 
                 }
-                else if (ne <= 0 || ipp <= 0 || ipp > ne){
+                else if (ne <= 0 || ipp <= 0 || (ipp > ne && dtwf <= 0)){
                     std::cerr << "Gene tree parameters are incorrectly specified. Only simulating species and locus trees\n";
-                    std::cerr << "Population size and individuals per population must both be positive integers and individuals per population must be less than or equal to the population size.\n";
-                    printSettings(outName, nt, r, nloc, ts, sbr, sdr, gbr, gdr, lgtr, ipp, ne, ngen, og, stn, mst);
+                    std::cerr << "Population size and individuals per population must both be positive integers and individuals per population must be less than or equal to the population size unless -dtwf is set.\n";
+                    printSettings(outName, nt, r, nloc, ts, sbr, sdr, gbr, gdr, lgtr, ipp, ne, ngen, og, stn, stf, mst);
                     printHelp();
                     exit(1);
                 }
                 else{
                     std::cout << "Simulating locus and gene trees on input species tree.\n";
-                    printSettings(outName, nt, r, nloc, ts, sbr, sdr, gbr, gdr, lgtr, ipp, ne, ngen, og, stn, mst);
+                    printSettings(outName, nt, r, nloc, ts, sbr, sdr, gbr, gdr, lgtr, ipp, ne, ngen, og, stn, stf, mst);
                 }
             }
         }
@@ -245,35 +399,35 @@ int main(int argc, char * argv[]) {
                         std::cout << "Gene birth rate is a negative number, no loci or gene trees will be simulated.\n";
                     }
                     else{
-                        if(ne >  0 && ipp > 0 && ipp <= ne){
+                        if(ne >  0 && ipp > 0 && (ipp <= ne || dtwf > 0)){
                             mt = 3;
                             std::cout << "Gene birth rate is 0.0, locus trees will match species trees.\n";
                         }
                         else{
                             std::cout << "Gene tree parameters are incorrectly specified. Only simulating species and locus trees\n";
-                            std::cout << "Population size and individuals per population must both be positive integers and individuals per population must be less than or equal to the population size.\n";
+                            std::cout << "Population size and individuals per population must both be positive integers and individuals per population must be less than or equal to the population size unless -dtwf is set.\n";
                             mt = 2;
                         }
                     }
-                    printSettings(outName, nt, r, nloc, ts, sbr, sdr, gbr, gdr, lgtr, ipp, ne, ngen, og, stn, mst);
+                    printSettings(outName, nt, r, nloc, ts, sbr, sdr, gbr, gdr, lgtr, ipp, ne, ngen, og, stn, stf, mst);
 
                 }
-                else if (ne <= 0 || ipp <= 0 || ipp > ne){
+                else if (ne <= 0 || ipp <= 0 || (ipp > ne && dtwf <= 0)){
                     mt = 2;
                     std::cout << "Gene tree parameters are incorrectly specified.\n";
-                    std::cout << "Population size and individuals per population must both be positive integers and individuals per population must be less than or equal to the population size.\n";
-                    printSettings(outName, nt, r, nloc, ts, sbr, sdr, gbr, gdr, lgtr, ipp, ne, ngen, og, stn, mst);
+                    std::cout << "Population size and individuals per population must both be positive integers and individuals per population must be less than or equal to the population size unless -dtwf is set.\n";
+                    printSettings(outName, nt, r, nloc, ts, sbr, sdr, gbr, gdr, lgtr, ipp, ne, ngen, og, stn, stf, mst);
                 }
                 else{
                     mt = 3;
                     std::cout << "Simulating sets of three trees.\n";
-                    printSettings(outName, nt, r, nloc, ts, sbr, sdr, gbr, gdr, lgtr, ipp, ne, ngen, og, stn, mst);
+                    printSettings(outName, nt, r, nloc, ts, sbr, sdr, gbr, gdr, lgtr, ipp, ne, ngen, og, stn, stf, mst);
                 }
             }
             else{
                 std::cout << "Number of loci to simulate is set to 0." << std::endl;
                 mt = 1;
-                printSettings(outName, nt, r, nloc, ts, sbr, sdr, gbr, gdr, lgtr, ipp, ne, ngen, og, stn, mst);
+                printSettings(outName, nt, r, nloc, ts, sbr, sdr, gbr, gdr, lgtr, ipp, ne, ngen, og, stn, stf, mst);
                 if(mst)
                     mt = 5;
             }
@@ -297,13 +451,47 @@ int main(int argc, char * argv[]) {
                                ngen,
                                og,
                                sout);
-        if(!stn.empty()){
+        phyEngine->setStatsSelector((unsigned) statsSel);
+        phyEngine->setSampleReconstructed(rec);
+        phyEngine->setDTWFSwitch(dtwf > 0 ? (unsigned) dtwf : 0);
+        phyEngine->setProfiling(prof);
+        phyEngine->setTracing(trace);
+        phyEngine->setMaxNodes(maxNodes > 0.0 ? (unsigned long) maxNodes : 0);
+        phyEngine->setMaxMemory(maxMem > 0.0 ? maxMem : 0.0);
+        phyEngine->setRateChanges(birthChanges, deathChanges);
+        phyEngine->setSamplingFraction(rho);
+        if(!stf.empty()){
+            phyEngine->setInputSpeciesTreeFile(stf);
+            phyEngine->setNumThreads(nth > 0 ? (unsigned) nth : 1);
+            if(!phyEngine->doRunSpTreeFile()){
+                delete phyEngine;
+                return 1;
+            }
+        }
+        else if(!stn.empty()){
             phyEngine->setInputSpeciesTree(stn);
-            phyEngine->doRunSpTreeSet();
+            if(!phyEngine->doRunSpTreeSet()){
+                delete phyEngine;
+                return 1;
+            }
+        }
+        else if(!swf.empty()){
+            phyEngine->setSweepFile(swf);
+            phyEngine->setNumThreads(nth > 0 ? (unsigned) nth : 1);
+            if(!phyEngine->doRunSweep()){
+                delete phyEngine;
+                return 1;
+            }
         }
-        else
+        else{
             // runs full simulation
-            phyEngine->doRunRun();
+            phyEngine->setCheckpointInterval(ckpt > 0 ? (unsigned) ckpt : 0);
+            phyEngine->setResume(resume);
+            if(!phyEngine->doRunRun()){
+                delete phyEngine;
+                return 1;
+            }
+        }
     }
 
     delete phyEngine;
@@ -14,6 +14,56 @@ cd ../test-3/
 treeducken -i popsize-100-settings.txt
 mkdir -p output/
 mv *.tre output/
-cd ..
+cd ../test-4/
+
+# the GSA has to finish although the death rate ends up above the speciation rate
+timeout 60 treeducken -i sdr-shift-settings.txt || echo "test-4: run with a death rate shift did not finish"
+for f in sdr-shift_*.sp.tre; do
+    ntips=$(grep "tree " $f | grep -o "T[0-9]*\[" | wc -l)
+    [ "$ntips" -eq 20 ] || echo "test-4: $f has $ntips tips instead of 20"
+done
+mkdir -p output/
+mv *.tre output/
+cd ../test-5/
+
+# the ages of trees stopped at ntax + k lineages should match those stopped at 100 * ntax, within 4 standard errors
+treeducken -i gsa-cutoff-settings.txt
+treeducken -i gsa-100ntax-settings.txt
+for stat in "Tree depth" "Extant tree depth"; do
+    awk -F'\t' -v stat="$stat" '$1 == stat { n[FILENAME] = $2; m[FILENAME] = $3; sd[FILENAME] = $4 }
+        END { a = "gsa-cutoff.summary.txt"; b = "gsa-100ntax.summary.txt"
+              se = sqrt(sd[a] ^ 2 / n[a] + sd[b] ^ 2 / n[b]); d = m[a] - m[b]
+              if(d < -4 * se || d > 4 * se) print "test-5: mean " stat " " m[a] " differs from " m[b] }' \
+        gsa-cutoff.summary.txt gsa-100ntax.summary.txt
+done
+mkdir -p output/
+mv *.tre output/
+cd ../test-6/
+
+# a run killed after a checkpoint and resumed writes the same files as a run that was never stopped
+rm -rf full resumed
+mkdir -p full resumed
+cd full/
+treeducken -i ../checkpoint-settings.txt > /dev/null
+cd ../resumed/
+treeducken -i ../checkpoint-settings.txt -ckpt 7 > /dev/null &
+pid=$!
+while kill -0 $pid 2> /dev/null && [ ! -f checkpoint.checkpoint ]; do
+    sleep 0.05
+done
+kill -9 $pid 2> /dev/null
+wait $pid 2> /dev/null
+if [ -f checkpoint.checkpoint ]; then
+    treeducken -i ../checkpoint-settings.txt -ckpt 7 -resume 1 > ../resume.log
+    grep -q "Resuming the run" ../resume.log || echo "test-6: run was not resumed from its checkpoint"
+    diff -r -x "*.checkpoint*" ../full . > /dev/null || echo "test-6: resumed run differs from the uninterrupted run"
+    rm -f ../resume.log
+else
+    echo "test-6: run finished before it was stopped at a checkpoint"
+fi
+cd ../..
+
+# unit tests of the library
+make -C unit check
 
 # run R script to check files
\ No newline at end of file
@@ -0,0 +1,31 @@
+#ifndef UnitTest_h
+#define UnitTest_h
+
+#include <cmath>
+#include <iostream>
+
+/**
+ * @brief Minimal checks for the unit tests, a failed check prints where it is and the test goes on
+ * @details Each test program includes this header once and returns unitTestResult(name) from main, which prints a
+ *          one line report and is nonzero if any check failed.
+ */
+static int unitTestChecks = 0;
+static int unitTestFailures = 0;
+
+static void unitTestCheck(bool ok, const char *expr, const char *file, int line){
+    unitTestChecks++;
+    if(!ok){
+        unitTestFailures++;
+        std::cerr << file << ":" << line << ": check failed: " << expr << std::endl;
+    }
+}
+
+static int unitTestResult(const char *name){
+    std::cout << name << ": " << unitTestChecks - unitTestFailures << " of " << unitTestChecks << " checks passed" << std::endl;
+    return unitTestFailures > 0 ? 1 : 0;
+}
+
+#define CHECK(cond) unitTestCheck((cond), #cond, __FILE__, __LINE__)
+#define CHECK_NEAR(a, b, tol) unitTestCheck(std::fabs((a) - (b)) <= (tol), #a " == " #b, __FILE__, __LINE__)
+
+#endif /* UnitTest_h */
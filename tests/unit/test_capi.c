@@ -0,0 +1,127 @@
+/*
+ * C interface of the library: settings, errors, deterministic replicates, and the layout of exported trees
+ */
+#include "TreeSimulationC.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int checks = 0;
+static int failures = 0;
+
+#define CHECK(cond) do { checks++; if(!(cond)) { failures++; fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); } } while(0)
+
+/* parents come before their children, only the first node is a root, and returns the number of nodes of a type */
+static int checkLayout(const td_tree *t, int nodeType){
+    int count = 0;
+    for(int32_t i = 0; i < t->num_nodes; i++){
+        if(i == 0)
+            CHECK(t->parent[i] == -1);
+        else
+            CHECK(t->parent[i] >= 0 && t->parent[i] < i);
+        CHECK(t->branch_length[i] >= 0.0);
+        CHECK(t->node_type[i] >= TD_NODE_INTERNAL && t->node_type[i] <= TD_NODE_DUPLICATION);
+        if(t->node_type[i] == nodeType)
+            count++;
+    }
+    return count;
+}
+
+int main(void){
+    td_settings s;
+    td_default_settings(&s);
+    CHECK(s.numTaxa == 100);
+    CHECK(s.speciesTree == NULL);
+    CHECK(s.samplingFraction == 1.0);
+
+    s.numTaxa = 1;
+    td_simulation *bad = td_create(&s, 1, 2);
+    CHECK(bad != NULL);
+    CHECK(td_error(bad) != NULL);
+    CHECK(td_simulate(bad) != 0);
+    td_destroy(bad);
+
+    s.numTaxa = 12;
+    s.spBirthRate = 1.0;
+    s.spDeathRate = 0.5;
+    s.numLoci = 2;
+    s.geneBirthRate = 0.2;
+    s.geneDeathRate = 0.1;
+    s.numGenes = 3;
+    s.indPerPop = 2;
+    s.popSize = 10;
+    td_simulation *sim = td_create(&s, 1859, 2019);
+    CHECK(sim != NULL && td_error(sim) == NULL);
+    CHECK(td_num_loci(sim) == 2);
+    CHECK(td_num_genes(sim) == 3);
+    CHECK(td_simulate(sim) == 0);
+
+    td_tree sp, lt, gt;
+    CHECK(td_view_tree(sim, TD_SPECIES_TREE, 0, 0, &sp) == 0);
+    CHECK(sp.num_nodes == td_tree_num_nodes(sim, TD_SPECIES_TREE, 0, 0));
+    CHECK(checkLayout(&sp, TD_NODE_EXTANT_TIP) == 12);
+
+    CHECK(td_view_tree(sim, TD_LOCUS_TREE, 1, 0, &lt) == 0);
+    int locusTips = checkLayout(&lt, TD_NODE_EXTANT_TIP);
+    CHECK(td_view_tree(sim, TD_GENE_TREE, 1, 2, &gt) == 0);
+    CHECK(checkLayout(&gt, TD_NODE_EXTANT_TIP) == 2 * locusTips);
+
+    CHECK(td_tree_num_nodes(sim, TD_LOCUS_TREE, 2, 0) == -1);
+    CHECK(td_tree_num_nodes(sim, TD_GENE_TREE, 0, 3) == -1);
+    CHECK(td_view_tree(sim, TD_GENE_TREE, -1, 0, &gt) == -1);
+
+    /* an export into arrays that are too small copies nothing, a large enough one copies the viewed values */
+    int32_t n = sp.num_nodes;
+    int32_t *parent = malloc(n * sizeof(int32_t));
+    int32_t *label = malloc(n * sizeof(int32_t));
+    double *brlen = malloc(n * sizeof(double));
+    CHECK(td_export_tree(sim, TD_SPECIES_TREE, 0, 0, n - 1, parent, brlen, label, NULL) == n);
+    CHECK(td_export_tree(sim, TD_SPECIES_TREE, 0, 0, n, parent, brlen, label, NULL) == n);
+    CHECK(memcmp(parent, sp.parent, n * sizeof(int32_t)) == 0);
+    CHECK(memcmp(label, sp.label, n * sizeof(int32_t)) == 0);
+    CHECK(memcmp(brlen, sp.branch_length, n * sizeof(double)) == 0);
+
+    /* the same seeds give the same replicate */
+    td_simulation *again = td_create(&s, 1859, 2019);
+    CHECK(td_simulate(again) == 0);
+    td_tree sp2;
+    CHECK(td_view_tree(again, TD_SPECIES_TREE, 0, 0, &sp2) == 0);
+    CHECK(sp2.num_nodes == n);
+    if(sp2.num_nodes == n){
+        CHECK(memcmp(sp2.parent, parent, n * sizeof(int32_t)) == 0);
+        CHECK(memcmp(sp2.branch_length, brlen, n * sizeof(double)) == 0);
+    }
+    td_destroy(again);
+    free(parent);
+    free(label);
+    free(brlen);
+
+    /* a given species tree is kept as it is */
+    td_settings given;
+    td_default_settings(&given);
+    given.speciesTree = "((A:1,B:1):1,C:2);";
+    given.numLoci = 1;
+    given.numGenes = 1;
+    given.indPerPop = 1;
+    given.popSize = 10;
+    td_simulation *onTree = td_create(&given, 3, 4);
+    CHECK(onTree != NULL && td_error(onTree) == NULL);
+    CHECK(td_simulate(onTree) == 0);
+    CHECK(td_view_tree(onTree, TD_SPECIES_TREE, 0, 0, &sp) == 0);
+    CHECK(sp.num_nodes == 5);
+    CHECK(checkLayout(&sp, TD_NODE_EXTANT_TIP) == 3);
+    for(int32_t i = 1; i < sp.num_nodes; i++)
+        CHECK(fabs(sp.branch_length[i] - 1.0) < 1e-9 || fabs(sp.branch_length[i] - 2.0) < 1e-9);
+    td_destroy(onTree);
+
+    /* only simulated species trees can be sampled */
+    given.samplingFraction = 0.5;
+    td_simulation *sampled = td_create(&given, 3, 4);
+    CHECK(sampled != NULL && td_error(sampled) != NULL);
+    td_destroy(sampled);
+
+    td_destroy(sim);
+    printf("test_capi: %d of %d checks passed\n", checks - failures, checks);
+    return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,108 @@
+#include "UnitTest.h"
+#include "Discordance.h"
+#include "NewickParser.h"
+#include <map>
+
+/**
+ * @brief Builds a gene tree with the topology of a Newick string, tip names are a species name, an underscore and a copy
+ *        number (A_1), every tip is extant and has the index of its species in the species tree
+ */
+static GeneTree* buildGeneTree(const std::string &newick, SpeciesTree *st, MbRandom *rando){
+    NewickParser np;
+    SpeciesTree *shape = np.parseSpeciesTree(newick, rando);
+    CHECK(shape != nullptr);
+    if(shape == nullptr)
+        return nullptr;
+    std::map<std::string, int> spIndex;
+    for(auto p : st->getNodes()){
+        if(p->getIsTip())
+            spIndex[p->getName()] = p->getIndex();
+    }
+
+    auto *gt = new GeneTree(rando, np.getNumTips(), 1, 1, 1.0);
+    std::map<Node*, Node*> copyOf;
+    for(auto p : shape->getNodes()){
+        Node *q = gt->newNode();
+        copyOf[p] = q;
+        if(p->getAnc() == nullptr)
+            gt->setRoot(q);
+        else{
+            Node *a = copyOf[p->getAnc()];
+            q->setAnc(a);
+            if(p == p->getAnc()->getLdes())
+                a->setLdes(q);
+            else
+                a->setRdes(q);
+        }
+        if(p->getIsTip()){
+            std::string sp = p->getName().substr(0, p->getName().find('_'));
+            CHECK(spIndex.count(sp) == 1);
+            q->setIsTip(true);
+            q->setIsExtant(true);
+            q->setIndx(spIndex[sp]);
+        }
+    }
+    delete shape;
+    return gt;
+}
+
+static Discordance discordanceOf(const std::string &geneNewick, SpeciesTree *st, MbRandom *rando){
+    Discordance d;
+    GeneTree *gt = buildGeneTree(geneNewick, st, rando);
+    if(gt != nullptr){
+        d.calcDiscordance(st, gt);
+        delete gt;
+    }
+    return d;
+}
+
+int main(){
+    MbRandom rando;
+    rando.setSeed(1, 2);
+    NewickParser np;
+    SpeciesTree *st = np.parseSpeciesTree("(((A:1,B:1):1,C:2):1,(D:2,E:2):1);", &rando);
+    CHECK(st != nullptr);
+    if(st == nullptr)
+        return unitTestResult("test_discordance");
+
+    // same topology as the species tree
+    Discordance d = discordanceOf("(((A_1,B_1),C_1),(D_1,E_1));", st, &rando);
+    CHECK(d.getNumTips() == 5);
+    CHECK(d.getRFDistance() == 0);
+    CHECK(d.getTripletDistance() == 0);
+    CHECK(d.getDeepCoalescences() == 0);
+
+    // A joins C first: clades {A,C} and {A,B} differ, only the triplet of A, B, C is resolved differently,
+    // and the lineages of A and B both leave the edge above their ancestor
+    d = discordanceOf("(((A_1,C_1),B_1),(D_1,E_1));", st, &rando);
+    CHECK(d.getRFDistance() == 2);
+    CHECK_NEAR(d.getNormRFDistance(), 2.0 / 6.0, 1e-12);
+    CHECK(d.getTripletDistance() == 1);
+    CHECK_NEAR(d.getNormTripletDistance(), 0.1, 1e-12);
+    CHECK(d.getDeepCoalescences() == 1);
+
+    // the copies of A and of E form clades and collapse to single tips
+    d = discordanceOf("((((A_1,A_2),B_1),C_1),(D_1,(E_1,E_2)));", st, &rando);
+    CHECK(d.getNumTips() == 7);
+    CHECK(d.getRFDistance() == 0);
+    CHECK(d.getTripletDistance() == 0);
+    CHECK(d.getDeepCoalescences() == 0);
+
+    // the copies of A are split, A_1 is the first copy and stands for A: ((A,C),B),(D,E) as above; both copies
+    // of A leave A, and A_1 and the ancestor of A_2 and B both leave the ancestor of A and B
+    d = discordanceOf("(((A_1,C_1),(A_2,B_1)),(D_1,E_1));", st, &rando);
+    CHECK(d.getNumTips() == 6);
+    CHECK(d.getRFDistance() == 2);
+    CHECK(d.getTripletDistance() == 1);
+    CHECK(d.getDeepCoalescences() == 2);
+
+    // the gene tree only has copies of A, B, and D, the species tree is restricted to them: ((A,B),D)
+    d = discordanceOf("((A_1,D_1),B_1);", st, &rando);
+    CHECK(d.getNumTips() == 3);
+    CHECK(d.getRFDistance() == 2);
+    CHECK_NEAR(d.getNormRFDistance(), 1.0, 1e-12);
+    CHECK(d.getTripletDistance() == 1);
+
+    delete st;
+    return unitTestResult("test_discordance");
+}
@@ -0,0 +1,86 @@
+#include "UnitTest.h"
+#include "NewickParser.h"
+
+/**
+ * @brief Reads a tree, prints it, reads the printed tree, and prints that again
+ */
+static std::string roundTrip(const std::string &newick, MbRandom *rando, std::string &firstPrint){
+    NewickParser np;
+    SpeciesTree *st = np.parseSpeciesTree(newick, rando);
+    CHECK(st != nullptr);
+    if(st == nullptr)
+        return "";
+    firstPrint = st->printNewickTree();
+    delete st;
+    st = np.parseSpeciesTree(firstPrint, rando);
+    CHECK(st != nullptr);
+    if(st == nullptr)
+        return "";
+    std::string secondPrint = st->printNewickTree();
+    delete st;
+    return secondPrint;
+}
+
+static bool parseFails(const std::string &newick, MbRandom *rando){
+    NewickParser np;
+    SpeciesTree *st = np.parseSpeciesTree(newick, rando);
+    bool failed = st == nullptr && !np.getErrorMessage().empty();
+    delete st;
+    return failed;
+}
+
+/**
+ * @brief Reading Newick trees: printed trees read back to the same tree, the syntax that is accepted, and the errors
+ */
+int main(){
+    MbRandom rando;
+    rando.setSeed(1, 2);
+    std::string firstPrint;
+
+    // printed trees, with their [&index=] comments, read back to the same tree
+    CHECK(roundTrip("((A:1,B:1):1,C:2);", &rando, firstPrint) == firstPrint);
+    CHECK(firstPrint.find("A[&index=") != std::string::npos);
+    CHECK(roundTrip("(((T1:0.5,T2:0.5):0.25,(T3:0.125,T4:0.125):0.625):1.5,T5:2.25);", &rando, firstPrint) == firstPrint);
+
+    // comments, quoted names, internal labels, spaces, and scientific notation
+    NewickParser np;
+    SpeciesTree *st = np.parseSpeciesTree(" ( ( 'a b''c' : 1.5e-1 , B[&x=1]:0.15 )lbl : 1 , C:1.15 ) ; ", &rando);
+    CHECK(st != nullptr);
+    CHECK(np.getNumTips() == 3);
+    if(st != nullptr){
+        std::vector<Node*> nodes = st->getNodes();
+        bool foundQuoted = false;
+        for(auto p : nodes){
+            if(p->getIsTip() && p->getName() == "a b'c"){
+                foundQuoted = true;
+                CHECK_NEAR(p->getBranchLength(), 0.15, 1e-12);
+            }
+        }
+        CHECK(foundQuoted);
+        CHECK(st->getExtantNodes().size() == 3);
+        delete st;
+    }
+
+    // tip names looked up in a translate table
+    TranslateTable tt = {{"1", "Homo"}, {"2", "Pan"}};
+    np.setTranslateTable(&tt);
+    st = np.parseSpeciesTree("(1:1,2:1);", &rando);
+    CHECK(st != nullptr);
+    if(st != nullptr){
+        CHECK(st->printNewickTree().find("Homo") != std::string::npos);
+        CHECK(st->printNewickTree().find("Pan") != std::string::npos);
+        delete st;
+    }
+    np.setTranslateTable(nullptr);
+
+    // errors leave a message instead of a tree
+    CHECK(parseFails("((A:1,B:1):1,C:2", &rando));
+    CHECK(parseFails("(A:1,B:1,C:1);", &rando));
+    CHECK(parseFails("((A:1):1,B:1);", &rando));
+    CHECK(parseFails("(A:1,B:1));", &rando));
+    CHECK(parseFails("A;", &rando));
+    CHECK(parseFails("(A:x,B:1);", &rando));
+    CHECK(parseFails("(A:1,B:1):1,C:1;", &rando));
+
+    return unitTestResult("test_parser");
+}
@@ -0,0 +1,129 @@
+#include "UnitTest.h"
+#include "SimServer.h"
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/**
+ * @brief Connects to the server socket, waiting for the server to listen
+ */
+static int connectTo(const std::string &path){
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    for(int attempt = 0; attempt < 200; attempt++){
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if(fd >= 0 && connect(fd, (sockaddr*) &addr, sizeof(addr)) == 0)
+            return fd;
+        if(fd >= 0)
+            close(fd);
+        usleep(10000);
+    }
+    return -1;
+}
+
+/**
+ * @brief Sends jobs, shuts down the sending side, and reads the replies until the server closes the connection
+ */
+static std::vector<std::vector<std::string> > sendJobs(const std::string &path, const std::string &jobs){
+    std::vector<std::vector<std::string> > replies;
+    int fd = connectTo(path);
+    CHECK(fd >= 0);
+    if(fd < 0)
+        return replies;
+    CHECK(send(fd, jobs.data(), jobs.size(), 0) == (ssize_t) jobs.size());
+    shutdown(fd, SHUT_WR);
+    std::string received;
+    char buf[4096];
+    ssize_t n;
+    while((n = recv(fd, buf, sizeof(buf), 0)) > 0)
+        received.append(buf, (size_t) n);
+    close(fd);
+
+    std::stringstream ss(received);
+    std::string line, field;
+    while(std::getline(ss, line)){
+        std::vector<std::string> fields;
+        std::stringstream ls(line);
+        while(std::getline(ls, field, '\t'))
+            fields.push_back(field);
+        replies.push_back(fields);
+    }
+    return replies;
+}
+
+static std::vector<std::vector<std::string> > repliesOf(const std::vector<std::vector<std::string> > &replies,
+                                                       const std::string &id){
+    std::vector<std::vector<std::string> > ofJob;
+    for(auto & r : replies){
+        if(!r.empty() && r[0] == id)
+            ofJob.push_back(r);
+    }
+    return ofJob;
+}
+
+/**
+ * @brief Runs a SimServer on a thread and talks to it as a client over its socket
+ */
+int main(){
+    std::string path = "/tmp/treeducken_test_server_" + std::to_string(getpid()) + ".sock";
+    SimServer server(path, 2, 1, 2);
+    bool serverOk = false;
+    std::thread serverThread([&](){ serverOk = server.run(); });
+
+    std::string jobs = "-id a -nt 6 -sbr 1 -sdr 0.2 -r 2 -sd1 5 -sd2 7\n"
+                       "# comments and empty lines are skipped\n"
+                       "\n"
+                       "-id b -nt 4 -sbr 1 -sdr 0 -nl 1 -gbr 0.1 -ng 2 -ipp 1 -ne 10 -sd1 3 -sd2 4\n"
+                       "-id c -nt 5 -bogus 1\n"
+                       "-id d -nt 5 -r 0\n";
+    auto replies = sendJobs(path, jobs);
+
+    auto a = repliesOf(replies, "a");
+    CHECK(a.size() == 5);
+    unsigned numSpecies = 0;
+    for(auto & r : a){
+        if(r.size() == 4 && r[2] == "extant_species"){
+            numSpecies++;
+            unsigned tips = 0;
+            for(size_t pos = r[3].find('T'); pos != std::string::npos; pos = r[3].find('T', pos + 1))
+                tips++;
+            CHECK(tips == 6);
+        }
+    }
+    CHECK(numSpecies == 2);
+    CHECK(!a.empty() && a.back().size() == 3 && a.back()[1] == "done" && a.back()[2] == "2");
+
+    // a species tree, its extant tree, one locus tree, and two gene trees with their extant trees
+    auto b = repliesOf(replies, "b");
+    CHECK(b.size() == 8);
+    unsigned numGenes = 0;
+    for(auto & r : b){
+        if(r.size() == 6 && r[2] == "gene" && r[3] == "0")
+            numGenes++;
+    }
+    CHECK(numGenes == 2);
+    CHECK(!b.empty() && b.back()[1] == "done" && b.back()[2] == "1");
+
+    auto c = repliesOf(replies, "c");
+    CHECK(c.size() == 1 && c[0].size() == 3 && c[0][1] == "error" && c[0][2] == "unknown flag -bogus");
+    auto d = repliesOf(replies, "d");
+    CHECK(d.size() == 1 && d[0].size() == 3 && d[0][1] == "error");
+
+    // a job with the same seeds on another connection gets the same trees
+    auto again = repliesOf(sendJobs(path, "-id a -nt 6 -sbr 1 -sdr 0.2 -r 2 -sd1 5 -sd2 7\n"), "a");
+    std::sort(a.begin(), a.end());
+    std::sort(again.begin(), again.end());
+    CHECK(again == a);
+
+    auto stop = sendJobs(path, "shutdown\n");
+    CHECK(stop.size() == 1 && stop[0].size() == 1 && stop[0][0] == "shutdown");
+    serverThread.join();
+    CHECK(serverOk);
+
+    return unitTestResult("test_server");
+}
@@ -0,0 +1,65 @@
+#include "UnitTest.h"
+#include "NewickParser.h"
+#include "TreeStatistics.h"
+
+/**
+ * @brief Reads a tree and calculates its statistics
+ */
+static TreeStatistics statsOf(const std::string &newick, bool extantOnly, MbRandom *rando){
+    NewickParser np;
+    TreeStatistics ts;
+    SpeciesTree *st = np.parseSpeciesTree(newick, rando);
+    CHECK(st != nullptr);
+    if(st != nullptr){
+        ts.calcStatistics(st, extantOnly);
+        delete st;
+    }
+    return ts;
+}
+
+/**
+ * @brief Colless, Sackin, cherries, and gamma of small trees worked out by hand
+ */
+int main(){
+    MbRandom rando;
+    rando.setSeed(1, 2);
+
+    // balanced tree of four tips
+    TreeStatistics ts = statsOf("((A:1,B:1):1,(C:1,D:1):1);", false, &rando);
+    CHECK(ts.getNumTips() == 4);
+    CHECK_NEAR(ts.getColless(), 0.0, 1e-12);
+    CHECK_NEAR(ts.getSackin(), 8.0, 1e-12);
+    CHECK(ts.getNumCherries() == 2);
+
+    // caterpillar with internode intervals of 1: T = 2 + 3 + 4 = 9, gamma = (3.5 - 4.5) / (9 sqrt(1/24))
+    ts = statsOf("(((A:1,B:1):1,C:2):1,D:3);", false, &rando);
+    CHECK(ts.getNumTips() == 4);
+    CHECK_NEAR(ts.getColless(), 3.0, 1e-12);
+    CHECK_NEAR(ts.getSackin(), 9.0, 1e-12);
+    CHECK(ts.getNumCherries() == 1);
+    CHECK_NEAR(ts.getGamma(), -1.0 / (9.0 * std::sqrt(1.0 / 24.0)), 1e-9);
+    std::vector<double> bt = ts.getBranchingTimes();
+    CHECK(bt.size() == 3);
+    if(bt.size() == 3){
+        CHECK_NEAR(bt[0], 3.0, 1e-9);
+        CHECK_NEAR(bt[1], 2.0, 1e-9);
+        CHECK_NEAR(bt[2], 1.0, 1e-9);
+    }
+
+    // the extinct tip X is skipped in the extant tree, leaving ((A,B),D)
+    ts = statsOf("(((A:1,B:1):1,X:0.5):1,D:3);", true, &rando);
+    CHECK(ts.getNumTips() == 3);
+    CHECK_NEAR(ts.getColless(), 1.0, 1e-12);
+    CHECK_NEAR(ts.getSackin(), 5.0, 1e-12);
+    CHECK(ts.getNumCherries() == 1);
+    ts = statsOf("(((A:1,B:1):1,X:0.5):1,D:3);", false, &rando);
+    CHECK(ts.getNumTips() == 4);
+    CHECK_NEAR(ts.getColless(), 3.0, 1e-12);
+
+    CHECK(TreeStatistics::parseSelector("colless,gamma") == (TreeStatistics::Stat_Colless | TreeStatistics::Stat_Gamma));
+    CHECK(TreeStatistics::parseSelector("all") == TreeStatistics::Stat_All);
+    CHECK(TreeStatistics::parseSelector("none") == 0);
+    CHECK(TreeStatistics::parseSelector("balance") < 0);
+
+    return unitTestResult("test_statistics");
+}
@@ -0,0 +1,87 @@
+#include "UnitTest.h"
+#include "RunSummary.h"
+#include <sstream>
+#include <vector>
+
+/**
+ * @brief Mean, variance, and quantiles of RunningStat and RunSummary against the exact values
+ */
+int main(){
+    // below the sketch size every value is kept and the quantiles are exact
+    RunningStat small;
+    for(int i = 100; i >= 1; i--)
+        small.addValue(i);
+    CHECK(small.getCount() == 100);
+    CHECK_NEAR(small.getMean(), 50.5, 1e-12);
+    CHECK_NEAR(small.getVariance(), 100.0 * 101.0 / 12.0, 1e-9);
+    CHECK_NEAR(small.getQuantile(0.5), 50.0, 1e-12);
+    CHECK_NEAR(small.getQuantile(0.975), 98.0, 1e-12);
+    CHECK_NEAR(small.getQuantile(0.0), 1.0, 1e-12);
+    CHECK_NEAR(small.getQuantile(1.0), 100.0, 1e-12);
+
+    // 1..n in a scrambled order, quantiles of a sketch of 128 values per level are within 2% of n of the exact ranks
+    const int n = 100000;
+    std::vector<double> values(n);
+    for(int i = 0; i < n; i++)
+        values[i] = (double) ((long long) i * 7919 % n + 1);
+    RunningStat all, firstHalf, secondHalf;
+    for(int i = 0; i < n; i++){
+        all.addValue(values[i]);
+        (i < n / 2 ? firstHalf : secondHalf).addValue(values[i]);
+    }
+    CHECK(all.getCount() == (unsigned long) n);
+    CHECK_NEAR(all.getMean(), (n + 1) / 2.0, 1e-6);
+    CHECK_NEAR(all.getVariance(), n * (n + 1.0) / 12.0, 1e-3);
+    CHECK(all.getMin() == 1.0 && all.getMax() == n);
+    for(double q : {0.025, 0.25, 0.5, 0.75, 0.975})
+        CHECK_NEAR(all.getQuantile(q), q * n, 0.02 * n);
+
+    // merging the sketches of two halves gives the exact moments and quantiles as close as one sketch
+    firstHalf.merge(secondHalf);
+    CHECK(firstHalf.getCount() == (unsigned long) n);
+    CHECK_NEAR(firstHalf.getMean(), all.getMean(), 1e-6);
+    CHECK_NEAR(firstHalf.getVariance(), all.getVariance(), 1e-3);
+    for(double q : {0.025, 0.5, 0.975})
+        CHECK_NEAR(firstHalf.getQuantile(q), q * n, 0.02 * n);
+
+    // a saved state reads back to the same statistic
+    std::stringstream state;
+    all.writeState(state);
+    RunningStat restored;
+    CHECK(restored.readState(state));
+    CHECK(restored.getCount() == all.getCount());
+    CHECK(restored.getMean() == all.getMean());
+    CHECK(restored.getVariance() == all.getVariance());
+    for(double q : {0.025, 0.5, 0.975})
+        CHECK(restored.getQuantile(q) == all.getQuantile(q));
+    std::stringstream badState("3 1.0");
+    CHECK(!restored.readState(badState));
+
+    // statistics keep the order they are first added in, values that are not finite are skipped
+    RunSummary rs;
+    rs.addValue("Tree depth", 2.0);
+    rs.addValue("Gamma", 0.5);
+    rs.addValue("Tree depth", 4.0);
+    rs.addValue("Gamma", std::nan(""));
+    std::stringstream table;
+    rs.printSummary(table);
+    std::string line;
+    std::vector<std::string> lines;
+    while(std::getline(table, line))
+        lines.push_back(line);
+    CHECK(lines.size() == 3);
+    if(lines.size() == 3){
+        CHECK(lines[1].compare(0, 13, "Tree depth\t2\t") == 0);
+        CHECK(lines[2].compare(0, 8, "Gamma\t1\t") == 0);
+    }
+
+    std::stringstream rsState, before, after;
+    rs.writeState(rsState);
+    RunSummary rsRestored;
+    CHECK(rsRestored.readState(rsState));
+    rs.printSummary(before);
+    rsRestored.printSummary(after);
+    CHECK(before.str() == after.str());
+
+    return unitTestResult("test_summary");
+}